@@ -0,0 +1,70 @@
+#!/bin/bash
+
+# Scraper stand-in for the OpenMetrics exporter (-m). Runs the simulated
+# daemon with the exporter on a Unix socket, scrapes it like an agent,
+# hangs up early on purpose and checks that the process survived.
+#
+#   dev_scripts/scrape_metrics.sh [executable]   (default output/sht3x)
+
+BIN=${1:-output/sht3x}
+SOCK=/tmp/sht3x_metrics_$$.sock
+CFG=/tmp/sht3x_metrics_$$.cfg
+LOG=/tmp/sht3x_metrics_$$.log
+
+cat > "$CFG" << EOF
+[SHT3X]
+type = sht3x
+bus = /dev/i2c-2
+address = 0x44
+[BARO]
+type = ms5607
+bus = /dev/i2c-2
+address = 0x76
+EOF
+
+fail() {
+    echo "FAIL: $1"
+    kill -9 "$PID" 2> /dev/null
+    echo "--- log: $LOG"
+    rm -f "$CFG"
+    exit 1
+}
+
+"$BIN" -s -d "$CFG" -m "$SOCK" > "$LOG" 2>&1 &
+PID=$!
+for i in $(seq 50); do
+    [ -S "$SOCK" ] && break
+    sleep 0.1
+done
+[ -S "$SOCK" ] || fail "exporter not listening on $SOCK"
+sleep 0.5 # a few reads published
+
+BODY=$(curl -s --unix-socket "$SOCK" http://localhost/metrics)
+echo "$BODY" | grep -q '^sensor_value{' || fail "no sensor values"
+echo "$BODY" | grep -q '^i2c_transactions_total{' || fail "no bus counters"
+[ "$(echo "$BODY" | tail -n 1)" = "# EOF" ] || fail "body not terminated"
+echo "scrape: $(echo "$BODY" | wc -l) lines"
+
+# Request and reset the connection without reading, the response is
+# written to a closed socket. The client fails too if the exporter died.
+python3 - "$SOCK" << 'EOF' 2> /dev/null
+import socket, struct, sys
+for _ in range(20):
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.connect(sys.argv[1])
+    s.sendall(b"GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n")
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+    s.close()
+EOF
+sleep 0.2
+kill -0 "$PID" 2> /dev/null || { wait "$PID"; fail "exporter died after early hang-ups, exit $?"; }
+echo "early hang-ups: survived"
+
+curl -s --unix-socket "$SOCK" http://localhost/metrics | grep -q '^# EOF' || fail "no scrape after hang-ups"
+
+kill -TERM "$PID"
+wait "$PID"
+RET=$?
+[ $RET -eq 0 ] || fail "exit status $RET"
+rm -f "$CFG" "$LOG"
+echo "PASS"
@@ -0,0 +1,197 @@
+/*
+ * File:     acquisition.hpp
+ * Notes:    Configuration driven device set for daemon mode, reloaded in place
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef ACQUISITION_H_
+#define ACQUISITION_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "config.hpp"
+#include "i_i2c.hpp"
+#include "recovery.hpp"
+#include "sample.hpp"
+#include "tca9548a.hpp"
+
+#define ACQ_PERIOD_US   (1000 * 1000) // Read interval when period_ms is not given
+#define ACQ_RECOVERY_US 10000         // Poll interval while a device is coming up
+#define ACQ_DEVICE_SAMPLES 8          // Most samples of one read, PAC193x
+
+/// @brief Device section of the configuration, the section name is the alias
+///
+///     [SHT3X]
+///     type = sht3x            # sht3x, ms5607 or pac193x
+///     bus = /dev/i2c-2
+///     address = 0x44
+///     period_ms = 1000
+///     mux = 0x70              # optional, behind a TCA9548A at this address
+///     channel = 2             # its channel 0..7
+///     repeatability = high    # sht3x: high, medium, low
+///     osr = 4096              # ms5607: 256 to 4096
+///     sample_rate = 1024      # pac193x: 1024, 256, 64, 8
+struct device_config
+{
+    std::string alias;
+    std::string type;
+    std::string bus;
+    uint8_t address = 0;
+    uint8_t mux = 0;         // Mux address, 0 if connected directly
+    uint8_t mux_channel = 0;
+    uint64_t period_us = ACQ_PERIOD_US;
+    std::string option; // Device specific setting, see above
+
+    /// @brief Same bus segment, devices on it need distinct addresses
+    bool same_segment(const device_config &o) const
+    {
+        return bus == o.bus && mux == o.mux && mux_channel == o.mux_channel;
+    }
+
+    /// @brief Same physical device, only the period or the option differ
+    bool same_device(const device_config &o) const
+    {
+        return type == o.type && same_segment(o) && address == o.address;
+    }
+
+    bool operator==(const device_config &o) const
+    {
+        return same_device(o) && period_us == o.period_us && option == o.option;
+    }
+};
+
+/// @brief Device sections of a parsed configuration
+/// @param sections Configuration file
+/// @param out Devices, replaced
+/// @return Action status, <0 on an invalid section
+int device_configs(const std::vector<config_section> &sections, std::vector<device_config> &out);
+
+/// @brief Driver, interface and recovery of one configured device
+class acq_device
+{
+public:
+    device_config cfg;
+    i_i2c i2c;
+    recovery rec;
+
+    virtual ~acq_device();
+
+    /// @brief Check the device specific option without touching the device
+    /// @return Action status, <0 if invalid
+    virtual int check(const device_config &c) const = 0;
+
+    /// @brief Take a new period and option, applied at once if online
+    /// @return Action status, <0 on failure
+    virtual int configure(const device_config &c) = 0;
+
+    /// @brief Trigger or fetch, whichever is due, never waits
+    /// @param now Monotonic time [us]
+    /// @param ts Sample timestamp of a trigger in this call
+    /// @param out Samples
+    /// @param max Capacity of out, at least ACQ_DEVICE_SAMPLES
+    /// @return Number of samples, 0 while measuring, <0 on failure
+    virtual int poll(uint64_t now, uint64_t ts, sample *out, size_t max) = 0;
+
+    /// @brief Monotonic time of the next trigger or fetch [us]
+    virtual uint64_t deadline() const = 0;
+
+    /// @brief Drop a running measurement, the next trigger at at with the
+    /// current period
+    /// @param at Monotonic time [us]
+    virtual void restart(uint64_t at) = 0;
+
+    /// @brief Leave the device idle before it is removed
+    virtual void shutdown() {}
+
+protected:
+    virtual int reset() = 0;
+    virtual int probe() = 0;
+
+    friend class acquisition;
+};
+
+/// @brief Daemon mode device set. Devices are built from the
+/// configuration and read on their own period by run(), each through a
+/// sensor_scheduler of its driver: triggered on the period and fetched
+/// at the ready deadline, conversions never block the loop. The steps
+/// due in one run() are grouped by mux channel, each channel is
+/// switched to at most once.
+///
+/// A reload is applied as a difference by alias: removed devices are
+/// stopped and closed, devices whose type, bus or address changed are
+/// replaced, a changed period or option is applied to the running
+/// device, new devices are brought up by recovery::start(). Nothing
+/// blocks, the devices that didn't change keep being read on schedule.
+/// An invalid configuration is rejected as a whole.
+class acquisition
+{
+public:
+    std::function<void(i_i2c &)> attach; // Route new interfaces, e.g. to a simulation
+    std::function<void(i_i2c &)> detach; // Interface is about to be closed and destroyed
+
+    // Statistics
+    uint32_t reloads = 0; // Configurations applied
+    uint32_t added = 0;
+    uint32_t removed = 0;
+    uint32_t changed = 0; // Reconfigured in place
+
+    acquisition(/* args */);
+    ~acquisition();
+
+    /// @brief Read a configuration file and apply it
+    /// @param path File
+    /// @param now Monotonic time [us]
+    /// @return Action status, <0 keeps the current devices
+    int load(const char *path, uint64_t now);
+
+    /// @brief Apply a set of devices
+    /// @param cfgs Devices, aliases and bus addresses unique
+    /// @param now Monotonic time [us]
+    /// @return Action status, <0 keeps the current devices
+    int apply(const std::vector<device_config> &cfgs, uint64_t now);
+
+    /// @brief Advance recovery and read every device that is due
+    /// @param now Monotonic time [us]
+    /// @param ts Sample timestamp
+    /// @param out Samples
+    /// @param max Capacity of out
+    /// @return Number of samples
+    size_t run(uint64_t now, uint64_t ts, sample *out, size_t max);
+
+    /// @brief Time of the next trigger, fetch or recovery action
+    /// @param now Monotonic time [us]
+    uint64_t next_wakeup(uint64_t now) const;
+
+    size_t size() const { return devices.size(); }
+    const acq_device *device(size_t i) const { return devices[i]; }
+
+private:
+    /// @brief Mux shared by the devices behind it
+    struct acq_mux
+    {
+        std::string bus;
+        i_i2c i2c;
+        tca9548a mux;
+        uint32_t users = 0;
+    };
+
+    std::vector<acq_device *> devices;
+    std::vector<acq_mux *> muxes;
+    mux_scheduler reads;
+
+    static acq_device *make(const std::string &type);
+    int start(const device_config &c, uint64_t now);
+    void remove(size_t i);
+    tca9548a *get_mux(const device_config &c);
+    void put_mux(tca9548a *m);
+    void read(acq_device *d, uint64_t now, uint64_t ts, sample *out, size_t max, size_t &count);
+};
+
+#endif /* ACQUISITION_H_ */
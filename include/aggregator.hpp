@@ -0,0 +1,128 @@
+/*
+ * File:     aggregator.hpp
+ * Notes:    Streaming windowed aggregation of high rate channels
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef AGGREGATOR_H_
+#define AGGREGATOR_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "sample.hpp"
+
+/// @brief Count, min, max, mean and variance, Welford update
+struct window_stats
+{
+    uint32_t count = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double m2 = 0; // sum of squared differences from the mean
+
+    void add(double x);
+    void reset();
+    double variance() const { return count > 1 ? m2 / (count - 1) : 0; }
+    double stddev() const;
+};
+
+/// @brief Statistics over the last N samples, O(1) update.
+/// Mean and variance add and remove samples with Welford's update,
+/// min and max come from monotonic queues (amortised O(1)).
+class rolling_window
+{
+    struct entry
+    {
+        uint64_t seq;
+        double value;
+    };
+
+    // Fixed capacity queue, no allocation after construction
+    struct mono_queue
+    {
+        std::vector<entry> buf;
+        size_t head = 0, size = 0;
+        entry &front() { return buf[head]; }
+        entry &back() { return buf[(head + size - 1) % buf.size()]; }
+        void push_back(const entry &e) { buf[(head + size++) % buf.size()] = e; }
+        void pop_front() { head = (head + 1) % buf.size(); size--; }
+        void pop_back() { size--; }
+    };
+
+public:
+    rolling_window(uint32_t length);
+
+    void add(double x);
+
+    /// @brief Statistics of the samples in the window
+    window_stats stats() const;
+
+private:
+    std::vector<double> ring;
+    uint64_t seq = 0; // samples seen
+    double mean = 0;
+    double m2 = 0;
+    mono_queue minq, maxq;
+};
+
+/// @brief Decimated record
+struct aggregate
+{
+    enum Window : uint8_t
+    {
+        TUMBLING, // all samples of [start, end)
+        ROLLING   // last N samples at end
+    };
+
+    uint32_t channel;
+    Window window;
+    uint64_t start; // [us]
+    uint64_t end;   // [us]
+    uint32_t count;
+    double min;
+    double max;
+    double mean;
+    double stddev;
+};
+
+/// @brief Pipeline stage: full rate samples in, one record per channel
+/// and period out. Transients survive decimation in min and max.
+class aggregator
+{
+    struct channel_state
+    {
+        uint64_t start = 0; // current tumbling window start
+        uint64_t last = 0;  // last sample time
+        window_stats tumbling;
+        rolling_window *rolling = nullptr;
+    };
+
+public:
+    uint64_t period_us = 1000000;   // Emit period, tumbling window length
+    uint32_t rolling_length = 0;    // Rolling window samples, 0 = off
+    std::function<void(const aggregate &)> emit; // Output
+
+    aggregator(/* args */);
+    ~aggregator();
+
+    /// @brief Feed one sample, emits when its channel's window is complete
+    void push(const sample &s);
+    void push(const sample *s, size_t n);
+
+    /// @brief Emit windows ended before now, for channels that went quiet
+    /// @param now [us]
+    void flush(uint64_t now);
+
+private:
+    std::unordered_map<uint32_t, channel_state> channels;
+
+    void close(uint32_t channel, channel_state &st);
+};
+
+#endif /* AGGREGATOR_H_ */
@@ -0,0 +1,148 @@
+/*
+ * File:     altimeter.hpp
+ * Notes:    Fixed point barometric altitude and vertical speed from MS5607 samples
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef ALTIMETER_H_
+#define ALTIMETER_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include "sample.hpp"
+#include "ms5607.hpp"
+
+#define ALT_P_MIN   30000  // Table range [0.01 mbar]
+#define ALT_P_MAX   120000
+#define ALT_P_SHIFT 7      // Table step 2^7 = 1.28 mbar
+#define ALT_TABLE   (((ALT_P_MAX - ALT_P_MIN) >> ALT_P_SHIFT) + 2)
+#define ALT_GAP_US  2000000 // Longer gaps restart the filter
+
+/// @brief Barometric altitude without pow() per sample. Same formula as
+/// ms5607::altitude(), 153.84615 * ((p0 / p)^0.19 - 1) * T, with the
+/// pressure term tabulated once per reference pressure and linearly
+/// interpolated in integers. The interpolation error is 2 mm at sea
+/// level and 3 cm at 300 mbar, the MS5607 resolves 20 cm at best.
+class baro_altitude
+{
+public:
+    /// @param p0 Reference pressure [0.01 mbar]
+    baro_altitude(int32_t p0 = 101325);
+
+    /// @brief Rebuild the table for another reference, e.g. QNH or ground level
+    /// @param p0 Reference pressure [0.01 mbar]
+    void set_reference(int32_t p0);
+    int32_t reference() const { return p0; }
+
+    /// @brief Altitude above the reference
+    /// @param pressure [0.01 mbar], clamped to the table range
+    /// @param temperature [0.01 °C]
+    /// @return [mm]
+    int32_t altitude(int32_t pressure, int32_t temperature) const
+    {
+        if (pressure < ALT_P_MIN)
+            pressure = ALT_P_MIN;
+        if (pressure > ALT_P_MAX)
+            pressure = ALT_P_MAX;
+        uint32_t x = pressure - ALT_P_MIN;
+        uint32_t i = x >> ALT_P_SHIFT;
+        int64_t f = table[i] + (((int64_t)(table[i + 1] - table[i]) * (x & ((1 << ALT_P_SHIFT) - 1))) >> ALT_P_SHIFT);
+        // [µm/K] * [0.01 K] / 100000 = [mm]
+        return (int32_t)(f * (temperature + 27315) / 100000);
+    }
+
+private:
+    int32_t p0;
+    int32_t table[ALT_TABLE]; // pressure term [µm/K]
+};
+
+/// @brief Alpha-beta filter on altitude in fixed point, Q16 millimetres.
+/// The gains are the steady state Kalman gains of a constant velocity
+/// model (Kalata's tracking index), computed from the two noise figures
+/// and the sample interval. They are recomputed only when the interval
+/// moves by more than 1/16, a sample costs a few integer multiplies.
+class alpha_beta
+{
+public:
+    float noise_mm = 200.0f;     // Measurement noise, standard deviation of the altitude [mm]
+    float accel_mm_s2 = 1000.0f; // Process noise, standard deviation of the vertical acceleration [mm/s²]
+
+    // Gains in use
+    float alpha = 0;
+    float beta = 0;
+
+    alpha_beta(/* args */);
+
+    /// @brief Start over with the next measurement, e.g. after changing the noise
+    void reset();
+
+    /// @brief Add a measurement
+    /// @param t Time [us]
+    /// @param z Altitude [mm]
+    void update(uint64_t t, int32_t z);
+
+    int32_t altitude() const { return (int32_t)(h >> 16); } // [mm]
+    int32_t speed() const { return (int32_t)(v >> 16); }    // [mm/s]
+
+private:
+    int64_t h = 0;        // [mm] Q16
+    int64_t v = 0;        // [mm/s] Q16
+    uint64_t last = 0;    // time of the last measurement
+    bool started = false;
+    uint32_t gain_dt = 0; // interval the gains were computed for [us]
+    int64_t ka = 0;       // alpha Q16
+    int64_t kb = 0;       // beta / dt, Q16 [1/s]
+
+    void gains(uint32_t dt);
+};
+
+/// @brief Streaming stage: altitude and vertical speed from every MS5607
+/// reading, D1/D2 codes compensated in integers with the calibration of
+/// baro, or BARO_P with the latest BARO_T from the IIO driver. Emits
+/// ALTITUDE and VSPEED samples with the node and timestamp of the input.
+class altimeter
+{
+public:
+    const ms5607 *baro = nullptr; // Calibration for the codes
+    baro_altitude model;
+    alpha_beta filter;
+
+    // Statistics
+    uint64_t updates = 0;
+
+    altimeter(/* args */);
+    ~altimeter();
+
+    /// @brief Consume samples and produce altitude and speed
+    /// @param in Samples, other kinds are ignored
+    /// @param n Number of samples
+    /// @param out Derived samples, two per reading
+    /// @param max Capacity of out, readings that don't fit are filtered but not emitted
+    /// @return Number of derived samples
+    size_t process(const sample *in, size_t n, sample *out, size_t max);
+
+    /// @brief Add one compensated reading
+    /// @param t Time [us]
+    /// @param pressure [0.01 mbar]
+    /// @param temperature [0.01 °C]
+    void update(uint64_t t, int32_t pressure, int32_t temperature);
+
+    int32_t altitude() const { return filter.altitude(); } // [mm]
+    int32_t speed() const { return filter.speed(); }       // [mm/s]
+
+private:
+    uint64_t d1_ts = 0;
+    uint32_t d1 = 0;
+    int32_t baro_t = 1500; // latest BARO_T, 15 °C until one arrives
+};
+
+/// @brief Time the altitude paths and the filter on synthetic readings and
+/// print per sample cost, model error and filter noise and lag
+/// @param n Samples per measurement
+void altimeter_benchmark(uint32_t n);
+
+#endif /* ALTIMETER_H_ */
@@ -0,0 +1,61 @@
+/*
+ * File:     bringup.hpp
+ * Notes:    Overlapped device initialisation
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef BRINGUP_H_
+#define BRINGUP_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <functional>
+#include <vector>
+
+/// @brief Brings up all devices at once.
+/// Reset commands of every device are issued back to back, then each
+/// device is finished as soon as its own settle time has passed, so the
+/// reset waits overlap and cold start costs the longest wait instead of
+/// the sum of all of them. The bus itself is still used by one
+/// transaction at a time.
+class bringup
+{
+public:
+    struct step
+    {
+        const char *alias;           // Name used in log messages
+        std::function<int()> begin;  // Reset/trigger, <0 on failure
+        uint32_t settle_us;          // Time between begin and finish
+        std::function<int()> finish; // Read-back and configuration, <0 on failure
+        uint64_t deadline;           // Time finish may run
+        int status;                  // Result, <0 on failure
+    };
+
+    bringup(/* args */);
+    ~bringup();
+
+    /// @brief Add device
+    /// @param alias Device name
+    /// @param begin Start of initialisation (may be empty)
+    /// @param settle_us Wait between begin and finish [us]
+    /// @param finish End of initialisation (may be empty)
+    void add(const char *alias, std::function<int()> begin, uint32_t settle_us, std::function<int()> finish);
+
+    /// @brief Bring up all added devices
+    /// @return Number of devices that failed
+    int run();
+
+    /// @brief Result of the step added as n-th
+    int status(size_t n) const { return steps[n].status; }
+
+    /// @brief Duration of the last run [us]
+    uint64_t elapsed_us = 0;
+
+private:
+    std::vector<step> steps;
+};
+
+#endif /* BRINGUP_H_ */
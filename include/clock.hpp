@@ -0,0 +1,72 @@
+/*
+ * File:     clock.hpp
+ * Notes:    Injectable time source, real or virtual
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include "stdint.h"
+
+/// @brief Time source used by drivers and pipeline for every wait
+class i_clock
+{
+public:
+    virtual ~i_clock() {}
+
+    /// @brief Monotonic time [us]
+    virtual uint64_t now_us() = 0;
+
+    /// @brief Wall clock time, for sample timestamps [us since epoch]
+    virtual uint64_t wall_us() = 0;
+
+    /// @brief Wait
+    /// @param us Duration [us]
+    virtual void sleep_us(uint64_t us) = 0;
+
+    /// @brief Wait for an absolute deadline, no drift over many periods
+    /// @param t Monotonic time [us]
+    virtual void sleep_until(uint64_t t) = 0;
+};
+
+/// @brief Kernel clocks, sleeping really waits
+class real_clock : public i_clock
+{
+public:
+    uint64_t now_us() override;
+    uint64_t wall_us() override;
+    void sleep_us(uint64_t us) override;
+    void sleep_until(uint64_t t) override; // clock_nanosleep(TIMER_ABSTIME)
+};
+
+/// @brief Virtual time, sleeping advances time instantly.
+/// Deterministic: starts at a fixed wall time unless told otherwise.
+class virtual_clock : public i_clock
+{
+public:
+    uint64_t epoch_us = 1704067200ull * 1000000; // 2024-01-01 00:00:00 UTC
+
+    uint64_t now_us() override { return time; }
+    uint64_t wall_us() override { return epoch_us + time; }
+    void sleep_us(uint64_t us) override { time += us; }
+    void sleep_until(uint64_t t) override { time = t > time ? t : time; }
+
+    /// @brief Advance time without a wait, e.g. for bus transfer time
+    void advance(uint64_t us) { time += us; }
+
+private:
+    uint64_t time = 0;
+};
+
+/// @brief Process wide clock, a real_clock unless set_clock() was called
+i_clock *clk();
+
+/// @brief Select process wide clock, call before devices are started
+/// @param c Clock, nullptr restores the real clock
+void set_clock(i_clock *c);
+
+#endif /* CLOCK_H_ */
@@ -0,0 +1,42 @@
+/*
+ * File:     config.hpp
+ * Notes:    INI style configuration file
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <string>
+#include <vector>
+#include <utility>
+
+/// @brief One [section] with its key = value lines, in file order
+struct config_section
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> keys;
+
+    /// @brief Value of a key
+    /// @return Value, def if the key is absent
+    const char *get(const char *key, const char *def = nullptr) const;
+
+    /// @brief Integer value of a key, decimal or 0x hex
+    /// @param value Destination, unchanged if the key is absent
+    /// @return Action status, <0 if the value is not a number
+    int get(const char *key, long long &value) const;
+};
+
+/// @brief Read a configuration file. Blank lines and lines starting
+/// with # or ; are skipped, a # after a value starts a comment.
+/// @param path File
+/// @param out Sections, replaced
+/// @return Action status, <0 on failure with the line logged
+int config_load(const char *path, std::vector<config_section> &out);
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,111 @@
+/*
+ * File:     events.hpp
+ * Notes:    ALERT pin events from the GPIO character device
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <functional>
+#include <vector>
+
+#define EVENT_LINES_MAX 16 // lines per source
+#define EVENT_BATCH     16 // events read at once
+
+/// @brief Edges to report
+enum class Edge : uint8_t
+{
+    RISING,  // active high ALERT, e.g. SHT3x
+    FALLING, // open drain active low ALERT, e.g. PAC193x
+    BOTH
+};
+
+/// @brief Edge on a line
+struct line_event
+{
+    uint32_t line;      // GPIO line offset
+    bool rising;        // edge direction
+    uint64_t timestamp; // [us], monotonic
+};
+
+/// @brief Where events come from, the GPIO chip or a simulation
+class event_source
+{
+public:
+    virtual ~event_source() {}
+
+    /// @brief Wait for events
+    /// @param ev Destination
+    /// @param max Capacity of ev
+    /// @param timeout_us Longest wait, 0 to poll
+    /// @return Number of events, 0 on timeout, <0 on failure
+    virtual int wait(line_event *ev, int max, uint64_t timeout_us) = 0;
+};
+
+/// @brief Line events of one GPIO chip through the v2 character device
+/// ABI. All lines are requested in one line request, its file descriptor
+/// is waited on with epoll so the thread sleeps until an edge arrives.
+class gpio_events : public event_source
+{
+public:
+    const char *chip = "/dev/gpiochip0"; // GPIO chip
+    const char *consumer = "sht3x";      // Label shown by gpioinfo
+
+    gpio_events(/* args */);
+    ~gpio_events();
+
+    /// @brief Add a line before Open()
+    /// @param line Line offset on the chip
+    /// @param edge Edges to report
+    /// @return Action status, <0 if full
+    int add(uint32_t line, Edge edge);
+
+    /// @brief Request the lines
+    /// @return Action status, <0 on failure
+    int Open();
+    void Close();
+
+    int wait(line_event *ev, int max, uint64_t timeout_us) override;
+
+private:
+    uint32_t lines[EVENT_LINES_MAX];
+    Edge edges[EVENT_LINES_MAX];
+    uint32_t nlines = 0;
+    int line_fd = -1;
+    int epoll_fd = -1;
+};
+
+/// @brief Calls a handler per line for every event of a source
+class alert_dispatcher
+{
+public:
+    event_source *source = nullptr;
+
+    // Statistics
+    uint64_t events = 0;    // dispatched events
+    uint64_t unhandled = 0; // events of lines without handler
+
+    alert_dispatcher(/* args */);
+    ~alert_dispatcher();
+
+    /// @brief Register handler for a line
+    /// @param line Line offset
+    /// @param handler Called with the event
+    void on(uint32_t line, std::function<void(const line_event &)> handler);
+
+    /// @brief Wait for events and dispatch them
+    /// @param timeout_us Longest wait
+    /// @return Number of events, <0 on failure
+    int dispatch(uint64_t timeout_us);
+
+private:
+    std::vector<std::pair<uint32_t, std::function<void(const line_event &)>>> handlers;
+};
+
+#endif /* EVENTS_H_ */
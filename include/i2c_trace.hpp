@@ -0,0 +1,112 @@
+/*
+ * File:     i2c_trace.hpp
+ * Notes:    I2C transaction recorder and replay backend
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef I2C_TRACE_H_
+#define I2C_TRACE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "i_i2c.hpp"
+
+#define TRACE_MAGIC   0x54433249 // "I2CT"
+#define TRACE_VERSION 1
+
+// Trace file layout, little endian:
+//   header: magic u32, version u16, reserved u16
+//   record: time u64 [ns since first record], ret i32, nmsgs u16,
+//           per message: addr u16, flags u16, len u16, len bytes
+// Write messages carry the bytes sent, read messages the bytes received.
+
+/// @brief Records every transaction of the interfaces it is attached to
+/// (i_i2c::tap). One recorder may be shared by all devices of a bus.
+class i2c_recorder : public i2c_tap
+{
+public:
+    i2c_recorder(/* args */);
+    ~i2c_recorder();
+
+    /// @brief Create trace file
+    /// @param path File name
+    /// @return Action status, <0 on failure
+    int Open(const std::string &path);
+
+    /// @brief Flush and close trace file
+    void Close();
+
+    void record(const struct i2c_msg *msgs, uint32_t nmsgs, int ret) override;
+
+    uint64_t transactions = 0; // Recorded transactions
+
+private:
+    FILE *file = nullptr;
+    uint64_t start = 0;
+};
+
+/// @brief Feeds a recorded trace back to unmodified drivers.
+/// Transactions are served in file order. Written bytes are compared
+/// with the recording, a difference is counted as a mismatch and the
+/// transaction fails, so decode changes show up as regressions.
+class i2c_replay : public i2c_backend
+{
+    struct message
+    {
+        uint16_t addr;
+        uint16_t flags;
+        uint16_t len;
+        uint32_t offset; // into data
+    };
+
+    struct transaction
+    {
+        uint64_t time; // [ns] since first transaction
+        int32_t ret;
+        uint32_t first; // into messages
+        uint16_t nmsgs;
+    };
+
+public:
+    bool realtime = false; // Keep recorded timing, else as fast as possible
+    bool loop = false;     // Restart at end of trace
+
+    // Statistics
+    uint64_t replayed = 0;
+    uint64_t mismatches = 0;
+    uint64_t bytes = 0;
+
+    i2c_replay(/* args */);
+    ~i2c_replay();
+
+    /// @brief Load trace into memory
+    /// @param path File name
+    /// @return Action status, <0 on failure
+    int Open(const std::string &path);
+
+    int transfer(struct i2c_msg *msgs, uint32_t nmsgs) override;
+
+    /// @brief Trace exhausted
+    bool done() const { return next >= trace.size(); }
+
+    /// @brief Number of transactions in trace
+    size_t size() const { return trace.size(); }
+
+    /// @brief Rewind to first transaction
+    void rewind();
+
+private:
+    std::vector<transaction> trace;
+    std::vector<message> messages;
+    std::vector<uint8_t> data;
+    size_t next = 0;
+    uint64_t start = 0; // replay start [ns]
+};
+
+#endif /* I2C_TRACE_H_ */
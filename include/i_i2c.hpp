@@ -23,15 +23,54 @@
 #include <iostream>
 
 
+class tca9548a;
+
+#define I2C_LATENCY_BUCKETS 9 // 8 upper bounds and the overflow bucket
+
+/// @brief Transport replacing the kernel adapter, e.g. trace replay
+class i2c_backend
+{
+public:
+    virtual ~i2c_backend() {}
+
+    /// @brief Execute combined transaction
+    /// @return Same convention as ioctl(I2C_RDWR), <0 on failure
+    virtual int transfer(struct i2c_msg *msgs, uint32_t nmsgs) = 0;
+};
+
+/// @brief Observer of every completed transaction
+class i2c_tap
+{
+public:
+    virtual ~i2c_tap() {}
+    virtual void record(const struct i2c_msg *msgs, uint32_t nmsgs, int ret) = 0;
+};
+
 class i_i2c
 {
 private:
-    int fd; // File descriptor
+    int fd = -1; // File descriptor
+
+    void count(uint64_t us, bool failed);
 
 public:
-    std::string alias;  // Device alias
-    std::string device; // Device name
+    const char *alias = "I2C"; // Device alias, not copied
+    const char *device = "";   // Device name, not copied
     uint8_t address;    // Slave address
+    i2c_backend *backend = nullptr; // Kernel adapter is used when not set
+    i2c_tap *tap = nullptr;         // Transaction recorder
+    tca9548a *mux = nullptr;        // Multiplexer the device is behind
+    uint8_t mux_channel = 0;        // Mux channel of the device
+
+    // Statistics, counted by Transfer(), any thread may read them with
+    // __atomic_load_n while transactions are running
+    uint64_t transactions = 0;
+    uint64_t errors = 0;
+    uint64_t latency_us = 0;                        // Sum over all transactions
+    uint64_t latency[I2C_LATENCY_BUCKETS] = {0};    // Transactions per bucket, not cumulative
+
+    // Upper bounds of the latency buckets [us], the last bucket has none
+    static constexpr uint32_t LATENCY_BOUNDS_US[I2C_LATENCY_BUCKETS - 1] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000};
 
     i_i2c(/* args */);
     ~i_i2c();
@@ -44,6 +83,21 @@ public:
     /// @return Action status
     int Close();
 
+    /// @brief Send I2C general call reset (0x06 to address 0x00)
+    /// @note Resets every device on the bus which supports it
+    /// @return Action status
+    int GeneralCallReset();
+
+    /// @brief Execute combined transaction (repeated start between messages)
+    /// @param msgs Messages, addresses are taken as is
+    /// @param nmsgs Number of messages
+    /// @return Action status
+    int Transfer(struct i2c_msg *msgs, uint32_t nmsgs);
+
+    /// @brief Device node, unique on the bus even behind muxes
+    /// @return address | (mux channel + 1) << 7 | (mux address & 7) << 11
+    uint16_t node() const;
+
     /// @brief Read from register
     /// @tparam T Command type uint8_t or uint16_t
     /// @param reg Register
@@ -96,11 +150,9 @@ public:
 template <typename T>
 int i_i2c::Read(T reg, uint8_t *value)
 {
-    struct i2c_rdwr_ioctl_data data;
-    struct i2c_msg *msgs = NULL;
+    struct i2c_msg msgs[2];
     uint8_t reg_size =  sizeof(T);
     uint8_t reg_buf[reg_size] = {0};
-    int ret = -1;
 
     if (reg_size == 1)
         reg_buf[0] = reg;
@@ -110,11 +162,6 @@ int i_i2c::Read(T reg, uint8_t *value)
         reg_buf[1] = (uint8_t)(reg & 0xFF);
     }
 
-    memset(&data, 0, sizeof(data));
-    msgs = (i2c_msg *)calloc(2, sizeof(struct i2c_msg));
-    if (NULL == msgs)
-        return ret;
-
     msgs[0].addr = address;
     msgs[0].flags = 0;
     msgs[0].len = reg_size;
@@ -123,22 +170,15 @@ int i_i2c::Read(T reg, uint8_t *value)
     msgs[1].flags = I2C_M_RD;
     msgs[1].len = 1;
     msgs[1].buf = value;
-    data.msgs = msgs;
-    data.nmsgs = 2;
-
-    ret = ioctl(fd, I2C_RDWR, &data);
-    free(msgs);
-    return ret;
+    return Transfer(msgs, 2);
 }
 
 template <typename T>
 int i_i2c::Write(T reg, uint8_t value)
 {
-    struct i2c_rdwr_ioctl_data data;
-    struct i2c_msg *msgs = NULL;
+    struct i2c_msg msgs[1];
     uint8_t reg_size =  sizeof(T);
     uint8_t buffer[1 + reg_size] = {0};
-    int ret = -1;
 
     if (reg_size == 1)
         buffer[0] = reg;
@@ -148,31 +188,19 @@ int i_i2c::Write(T reg, uint8_t value)
         buffer[1] = (uint8_t)(reg & 0xFF);
     }
     buffer[reg_size] = value;
-    memset(&data, 0, sizeof(data));
-    msgs = (i2c_msg *)calloc(1, sizeof(struct i2c_msg));
-    if (NULL == msgs)
-        return ret;
-
     msgs[0].addr = address;
     msgs[0].flags = 0;
     msgs[0].len = 1 + reg_size;
     msgs[0].buf = buffer;
-    data.msgs = msgs;
-    data.nmsgs = 1;
-
-    ret = ioctl(fd, I2C_RDWR, &data);
-    free(msgs);
-    return ret;
+    return Transfer(msgs, 1);
 }
 
 template <typename T>
 int i_i2c::Write(T reg, uint8_t *buf, uint16_t size)
 {
-    struct i2c_rdwr_ioctl_data data;
-    struct i2c_msg *msgs = NULL;
+    struct i2c_msg msgs[1];
     uint8_t reg_size =  sizeof(T);
     uint8_t buffer[size + reg_size] = {0};
-    int ret = -1;
 
     if (reg_size == 1)
         buffer[0] = reg;
@@ -183,31 +211,19 @@ int i_i2c::Write(T reg, uint8_t *buf, uint16_t size)
     }
     
     memcpy(buffer + reg_size, buf, size);
-    memset(&data, 0, sizeof(data));
-    msgs = (i2c_msg *)calloc(1, sizeof(struct i2c_msg));
-    if (NULL == msgs)
-        return ret;
-
     msgs[0].addr = address;
     msgs[0].flags = 0;
     msgs[0].len = size + reg_size;
     msgs[0].buf = buffer;
-    data.msgs = msgs;
-    data.nmsgs = 1;
-
-    ret = ioctl(fd, I2C_RDWR, &data);
-    free(msgs);
-    return ret;
+    return Transfer(msgs, 1);
 }
 
 template <typename T>
 int i_i2c::Write(T reg)
 {
-    struct i2c_rdwr_ioctl_data data;
-    struct i2c_msg *msgs = NULL;
+    struct i2c_msg msgs[1];
     int size = sizeof(T);
     uint8_t buffer[size] = {0};
-    int ret = -1;
 
     if (size == 1)
         buffer[0] = reg;
@@ -217,31 +233,19 @@ int i_i2c::Write(T reg)
         buffer[1] = (uint8_t)(reg & 0xFF);
     }
 
-    memset(&data, 0, sizeof(data));
-    msgs = (i2c_msg *)calloc(1, sizeof(struct i2c_msg));
-    if (NULL == msgs)
-        return ret;
-
     msgs[0].addr = address;
     msgs[0].flags = 0;
     msgs[0].len = size;
     msgs[0].buf = buffer;
-    data.msgs = msgs;
-    data.nmsgs = 1;
-
-    ret = ioctl(fd, I2C_RDWR, &data);
-    free(msgs);
-    return ret;
+    return Transfer(msgs, 1);
 }
 
 template <typename T>
 int i_i2c::Read(T reg, uint8_t *buf, uint16_t size)
 {
-    struct i2c_rdwr_ioctl_data data;
-    struct i2c_msg *msgs = NULL;
+    struct i2c_msg msgs[2];
     int reg_size = sizeof(T);
     uint8_t reg_buf[reg_size] = {0};
-    int ret = -1;
 
     if (reg_size == 1)
         reg_buf[0] = reg;
@@ -251,11 +255,6 @@ int i_i2c::Read(T reg, uint8_t *buf, uint16_t size)
         reg_buf[1] = (uint8_t)(reg & 0xFF);
     }
 
-    memset(&data, 0, sizeof(data));
-    msgs = (i2c_msg *)calloc(2, sizeof(struct i2c_msg));
-    if (NULL == msgs)
-        return ret;
-
     msgs[0].addr = address;
     msgs[0].flags = 0;
     msgs[0].len = reg_size;
@@ -264,12 +263,7 @@ int i_i2c::Read(T reg, uint8_t *buf, uint16_t size)
     msgs[1].flags = I2C_M_RD;
     msgs[1].len = size;
     msgs[1].buf = buf;
-    data.msgs = msgs;
-    data.nmsgs = 2;
-
-    ret = ioctl(fd, I2C_RDWR, &data);
-    free(msgs);
-    return ret;
+    return Transfer(msgs, 2);
 }
 
 #endif
@@ -0,0 +1,96 @@
+/*
+ * File:     metrics.hpp
+ * Notes:    OpenMetrics text exporter of the latest values and bus counters
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "i_i2c.hpp"
+#include "sample.hpp"
+#include "shm_table.hpp"
+
+#define METRICS_PORT       9464        // Default TCP port on 127.0.0.1
+#define METRICS_BUFFER     (64 * 1024) // Response capacity, longer bodies are cut
+#define METRICS_TIMEOUT_MS 1000        // A scraper has this long to send its request
+
+/// @brief Prometheus/OpenMetrics text exporter for a local agent.
+///
+///     sensor_value{node="0x0044",kind="SHT3X_T",index="0",unit="°C"} 23.512
+///     sensor_timestamp_seconds{...} 1704067201.000000
+///     i2c_transactions_total{device="SHT3X",node="0x0044"} 120
+///     i2c_errors_total{...}, i2c_latency_seconds histogram
+///
+/// A thread of its own serves one HTTP scrape at a time. The values come
+/// from the shared memory table of shm_publisher and the counters from
+/// the registered interfaces, so a scrape never touches the bus and never
+/// waits on acquisition. The response is rendered into one buffer
+/// allocated by Start(), a scrape allocates nothing. A publisher that
+/// starts late or restarts is picked up by the next scrape.
+class metrics_exporter
+{
+public:
+    std::string endpoint;            // Unix socket if it starts with '/', otherwise TCP port on 127.0.0.1
+    std::string shm_name = SHM_NAME; // Table with the latest values, set before Start()
+
+    // Statistics, read them after Stop()
+    uint64_t scrapes = 0;
+    uint64_t truncated = 0; // Responses cut at METRICS_BUFFER
+
+    metrics_exporter(/* args */);
+    ~metrics_exporter();
+
+    /// @brief Listen on endpoint and start serving
+    /// @return Action status, <0 on failure
+    int Start();
+
+    /// @brief Stop serving and close the socket
+    void Stop();
+
+    /// @brief Export the counters of an interface, e.g. from the attach hook.
+    /// Labels are built here, the interface must outlive the registration.
+    void add(const i_i2c *bus);
+
+    /// @brief Stop exporting an interface before it is closed or destroyed
+    void remove(const i_i2c *bus);
+
+    /// @brief Render the current metrics
+    /// @return Body, valid until the next render(), its length in len
+    const char *render(size_t &len);
+
+private:
+    struct bus_labels
+    {
+        const i_i2c *bus;
+        char labels[64]; // device="...",node="0x...."
+    };
+
+    std::mutex lock; // Guards buses, held while rendering their counters
+    std::vector<bus_labels> buses;
+    shm_reader table;
+    std::vector<sample> latest;
+
+    char *buf = nullptr; // METRICS_BUFFER, rendered body
+    size_t used = 0;
+    bool full = false;   // A line didn't fit, the rest of the body is left out
+    int fd = -1;
+    int wake = -1; // eventfd, stops the thread
+    std::thread worker;
+
+    void run();
+    void serve(int client);
+    void put(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#endif /* METRICS_H_ */
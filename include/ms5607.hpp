@@ -13,17 +13,22 @@
 #include "stdint.h"
 #include "stdbool.h"
 #include <math.h>
+#include <string>
 
 #include "i_i2c.hpp"
+#include "sensor.hpp"
 
 #define READ    0x00     // adc read command
 #define PROM    0xA0 // prom read command
 #define RESET   0x1E     // soft reset command
 
+#define RESET_DELAY_US    3000 // PROM reload time after reset
+#define PROM_WORDS        8    // factory data, C1..C6 and CRC-4
+
 #define ACTION_OK 1
 #define ACTION_FAIL 0
 
-class ms5607
+class ms5607 : public sensor<ms5607>
 {
 private:
     const float P0 = 1013.25;
@@ -32,10 +37,18 @@ private:
     uint16_t CONV_D2 = 0x58;         // corresponding pressure conv. command for OSR
     uint8_t CONV_DELAY = 10;            // corresponding conv. delay for OSR
     uint16_t C1, C2, C3, C4, C5, C6; // Calibration from device
+    uint8_t phase = 0;               // Conversion of the contract, 0 idle, 1 D1, 2 D2
+
+    std::string cache_path();
+    int load_cache(uint16_t prom[PROM_WORDS]);
+    int save_cache(const uint16_t prom[PROM_WORDS]);
 
 public:
+    static constexpr size_t SENSOR_SAMPLES = 2; // MS5607_D1, MS5607_D2
+
     unsigned long DP, DT;
     i_i2c *i2c;
+    std::string cache_dir; // PROM cache directory, empty to disable
 
     ms5607(/* args */);
     ~ms5607();
@@ -48,16 +61,36 @@ public:
     /// @return Action status
     int reset();
 
+    /// @brief Send reset command without waiting for PROM reload
+    /// @return Action status
+    int soft_reset();
+
     /// @brief Read the raw data and convert into unsigned int
     /// @param reg Register
     /// @param value Returned value
     /// @return Action status
     int read_uint16(uint8_t reg, uint16_t &value);
 
-    /// @brief Read calibration data from PROM
+    /// @brief Read calibration data from cache or PROM, always with a bus
+    /// access, so it doubles as the probe of recovery
     /// @return Action status
     int calibration();
 
+    /// @brief Read whole PROM in one combined transaction
+    /// @param prom Destination
+    /// @return Action status
+    int read_prom(uint16_t prom[PROM_WORDS]);
+
+    /// @brief PROM CRC-4 (AN520)
+    /// @param prom PROM content
+    /// @return CRC, to compare with the low nibble of word 7
+    static uint8_t crc4(const uint16_t prom[PROM_WORDS]);
+
+    /// @brief Check PROM content
+    /// @param prom PROM content
+    /// @return true if CRC matches
+    static bool prom_valid(const uint16_t prom[PROM_WORDS]);
+
     /// @brief Read raw data
     /// @return Action status
     int read();
@@ -72,9 +105,52 @@ public:
     /// @return
     int do_job(uint8_t cmd, unsigned long &value);
 
+    /// @brief Read result of the last conversion
+    /// @param value Returned 24 bit code, 0 if the conversion was not complete
+    /// @return Action status
+    int read_adc(unsigned long &value);
+
+    /// @brief Conversion commands and time for the current OSR,
+    /// for triggers built outside the driver
+    uint8_t d1_cmd() const { return CONV_D1; }
+    uint8_t d2_cmd() const { return CONV_D2; }
+    uint32_t conv_us() const { return CONV_DELAY * 1000; }
+
     float get_temperature();
     float get_pressure();
     float get_altitude();
+
+    /// @brief Barometric altitude
+    /// @param pressure [mbar]
+    /// @param temperature [°C]
+    /// @param p0 Reference pressure [mbar]
+    /// @return [m]
+    static float altitude(float pressure, float temperature, float p0 = 1013.25f);
+
+    /// @brief Compensate raw conversions with the calibration of this device
+    /// @param d1 Digital pressure
+    /// @param d2 Digital temperature
+    /// @return [°C], [mbar]
+    float temperature(unsigned long d2) const;
+    float pressure(unsigned long d1, unsigned long d2) const;
+
+    /// @brief Integer compensation, as the datasheet specifies it
+    /// @param d1 Digital pressure
+    /// @param d2 Digital temperature
+    /// @param temp Temperature [0.01 °C]
+    /// @param pressure Pressure [0.01 mbar]
+    void compensate(uint32_t d1, uint32_t d2, int32_t &temp, int32_t &pressure) const;
+
+    /// @brief Sensor contract, D1 and D2 without blocking: trigger()
+    /// starts D1, the first fetch() reads it, starts D2 and returns
+    /// PENDING, the second reads D2. A code of 0 means the conversion
+    /// was cut short by another command, INVALID.
+    Status trigger();
+    uint32_t ready_us() const { return conv_us(); }
+    Status fetch();
+    size_t decode(uint64_t ts, sample *out, size_t max) const;
 };
 
+static_assert(is_sensor_v<ms5607>, "ms5607 implements the sensor contract");
+
 #endif /* MS5607_H_ */
\ No newline at end of file
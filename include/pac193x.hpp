@@ -13,17 +13,9 @@
 #include "stdint.h"
 #include "stdbool.h"
 #include "i_i2c.hpp"
+#include "sensor.hpp"
+#include "read_cache.hpp"
 
-
-class pac193x
-{
-    enum Channel
-    {
-        CH1 = 0,
-        CH2 = 1,
-        CH3 = 2,
-        CH4 = 3,
-    };
 #define SENSE1 0x0B
 #define SENSE2 0x0C
 #define SENSE3 0x0D
@@ -32,29 +24,142 @@ class pac193x
 #define BUS2 0x08
 #define BUS3 0x09
 #define BUS4 0x0A
+#define AVG_OFFSET 0x08 // VBUS_AVG/VSENSE_AVG follow VBUS/VSENSE
 
 #define I2C_ADR     0x10
     #define REFRESH 0x00
+    #define REFRESH_V 0x1F // Update readable registers, accumulators keep running
     #define CTRL_REG    0x01
     #define ID_REG      0xFD
     #define NEG_PWR     0x1D // Enabling bidirectional current and bipolar voltage measurements
 
+    #define REFRESH_DELAY_US 1000 // accumulator update time after REFRESH
+
     #define OVERFLOW    0x0A   // Turn on ALERT on overflow
+    #define ALERT_PIN   0x08   // CTRL: ALERT function of the ALERT/SLOW pin
+    #define ALERT_CC    0x04   // CTRL: ALERT pulse at the end of every conversion cycle
+    #define OVF_ALERT   0x02   // CTRL: ALERT on accumulator overflow
+    #define SAMPLE_RATE_MASK 0xC0 // CTRL: sample rate bits 7:6
     #define BIDIRECTIONAL 1
     #define UNIDIRECTIONAL 0
 
-private:
+/// @brief Device variants, channel count and product ID
+struct pac1931 { static constexpr uint8_t channels = 1; static constexpr uint8_t product_id = 0x58; };
+struct pac1932 { static constexpr uint8_t channels = 2; static constexpr uint8_t product_id = 0x59; };
+struct pac1933 { static constexpr uint8_t channels = 3; static constexpr uint8_t product_id = 0x5A; };
+struct pac1934 { static constexpr uint8_t channels = 4; static constexpr uint8_t product_id = 0x5B; };
+
+/// @brief Variant independent part, for code handling any PAC193x
+class pac193x_base
+{
 public:
+    enum Channel
+    {
+        CH1 = 0,
+        CH2 = 1,
+        CH3 = 2,
+        CH4 = 3,
+    };
+
+    /// @brief Conversion rate, CTRL bits 7:6
+    enum class SampleRate : uint8_t
+    {
+        SPS_1024,
+        SPS_256,
+        SPS_64,
+        SPS_8
+    };
+
     i_i2c *i2c;
-    float R[4] = {10, 10, 10, 10}; // Resistor values [mOhms]
+    int last_status = 1; // Status of the last register read
+    const uint8_t channels;
+
+    /// @brief Send REFRESH command without waiting for the update
+    /// @return Action status
+    int refresh();
+
+    /// @brief Send REFRESH_V, new readable registers without restarting
+    /// the accumulators, e.g. after a conversion complete ALERT
+    /// @return Action status
+    int refresh_v();
+
+    /// @brief Select what drives the ALERT pin (open drain, active low).
+    /// CTRL is read and written back, it takes effect with the REFRESH
+    /// sent here, which also restarts the accumulators.
+    /// @param conversion Pulse at the end of every conversion cycle
+    /// @param overflow Assert on accumulator overflow
+    /// @return Action status
+    int set_alert(bool conversion, bool overflow);
+
+    /// @brief Set the conversion rate, takes effect like set_alert()
+    /// @param rate Rate
+    /// @return Action status
+    int set_sample_rate(SampleRate rate);
+
+protected:
+    pac193x_base(uint8_t channels);
 
-    pac193x(/* args */);
-    ~pac193x();
+    /// @brief Read-modify-write of CTRL, then REFRESH so it takes effect
+    /// @return Action status
+    int update_ctrl(uint8_t mask, uint8_t value);
+};
+
+/// @brief PAC193x of one variant. Channel count, product ID and block
+/// sizes are compile time constants. The variants with fewer channels
+/// skip the registers of the missing channels in auto-increment reads,
+/// so VBUS and VSENSE of all channels come in one block read of
+/// BLOCK_SIZE bytes. Directions are cached, NEG_PWR is read by init()
+/// and written only through the set_*_drct() methods.
+template <typename Variant>
+class pac193x_t : public pac193x_base, public sensor<pac193x_t<Variant>>
+{
+public:
+    static constexpr uint8_t CHANNELS = Variant::channels;
+    static constexpr uint8_t PRODUCT_ID = Variant::product_id;
+    static constexpr uint8_t BLOCK_SIZE = 2 * CHANNELS * 2; // VBUS and VSENSE, 16 bit each
+    static constexpr size_t SENSOR_SAMPLES = 2 * CHANNELS;   // PAC_VBUS, PAC_VSENSE per channel
 
-    /// @brief Init device
+    static_assert(CHANNELS >= 1 && CHANNELS <= 4, "PAC193x has 1 to 4 channels");
+
+    static constexpr uint8_t vbus_reg(uint8_t ch, bool mean) { return BUS1 + ch + (mean ? AVG_OFFSET : 0); }
+    static constexpr uint8_t vsense_reg(uint8_t ch, bool mean) { return SENSE1 + ch + (mean ? AVG_OFFSET : 0); }
+
+    /// @brief Raw codes of all channels
+    struct reading
+    {
+        uint16_t vbus[CHANNELS];
+        uint16_t vsense[CHANNELS];
+    };
+
+    float current_lsb[CHANNELS]; // Unipolar current step per channel [mA]
+    bool fetch_mean = true;      // fetch() reads the averaged registers
+    read_cache<reading> readings[2]; // [instant, averaged] registers, shared by the getters with max_age_us
+
+    pac193x_t(/* args */);
+    ~pac193x_t();
+
+    /// @brief Set the conversion rate and drop the cached readings
+    /// @param rate Rate
+    /// @return Action status
+    int set_sample_rate(SampleRate rate);
+
+    /// @brief Init device, check product ID, turn on the overflow ALERT
+    /// and read directions. The rest of CTRL is left as it is.
+    /// Needed after every power-on or reset, decode() relies on the
+    /// directions read here.
     /// @return Action status
     int init();
 
+    /// @brief Set sense resistor and precompute the current step
+    /// @param ch Channel
+    /// @param mohm Resistor [mOhms]
+    void set_resistor(uint8_t ch, float mohm);
+
+    /// @brief Sense resistor
+    /// @param ch Channel
+    /// @return [mOhms]
+    float get_resistor(uint8_t ch) const { return R[ch]; }
+
     /// @brief Set Voltage Direction
     /// @param ch Channel
     /// @param direction Direction
@@ -67,20 +172,79 @@ public:
     /// @return Action status
     int set_current_drct(uint8_t ch, bool direction);
 
-    /// @brief Get Voltage Direction
+    /// @brief Get Voltage Direction, cached
     /// @param ch Channel
     /// @return BIDIRECTIONAL 1, UNIDIRECTIONAL 0
-    bool get_voltage_drct(uint8_t ch);
+    bool get_voltage_drct(uint8_t ch) const;
 
-    /// @brief Get Current Direction
+    /// @brief Get Current Direction, cached
     /// @param ch Channel
     /// @return BIDIRECTIONAL 1, UNIDIRECTIONAL 0
-    bool get_current_drct(uint8_t ch);
+    bool get_current_drct(uint8_t ch) const;
+
+    /// @brief Read VBUS and VSENSE of all channels in one block read
+    /// @param r Destination
+    /// @param mean Averaged registers
+    /// @return Action status
+    int read(reading &r, bool mean);
+
+    /// @brief Convert a reading, no branches, no bus access
+    /// @param r Reading
+    /// @param voltage Bus voltages [V]
+    /// @param current Currents [mA]
+    void decode(const reading &r, float voltage[CHANNELS], float current[CHANNELS]) const;
 
     float get_current(uint8_t ch, bool mean);
     float get_bus_voltage(uint8_t ch, bool mean);
     float get_sense_voltage(uint8_t ch, bool mean);
     uint16_t get_voltage_raw(uint8_t reg, bool mean);
+
+    /// @brief From one REFRESH_V and block read shared by all callers, see
+    /// read_cache. Concurrent callers of any channel wait for the same read.
+    /// @param ch Channel
+    /// @param mean Averaged registers
+    /// @param max_age_us Oldest acceptable reading [us]
+    /// @return [mA], [V], NAN on failure
+    float get_current(uint8_t ch, bool mean, uint64_t max_age_us);
+    float get_bus_voltage(uint8_t ch, bool mean, uint64_t max_age_us);
+
+    /// @brief Convert raw codes read with get_voltage_raw()
+    /// @param ch Channel
+    /// @param raw Register value
+    /// @return [V], [uV], [mA]
+    float bus_voltage(uint8_t ch, uint16_t raw) const;
+    float sense_voltage(uint8_t ch, uint16_t raw) const;
+    float current(uint8_t ch, uint16_t raw) const;
+
+    /// @brief Sensor contract: trigger() sends REFRESH_V, fetch() reads
+    /// the block after the update time, the accumulators keep running
+    Status trigger() { return refresh_v() ? Status::OK : Status::IO; }
+    uint32_t ready_us() const { return REFRESH_DELAY_US; }
+    Status fetch() { return read(result, fetch_mean) ? Status::OK : Status::IO; }
+    size_t decode(uint64_t ts, sample *out, size_t max) const;
+
+private:
+    float R[CHANNELS];   // Resistor values [mOhms], current_lsb follows them
+    reading result; // Last fetch()
+    uint8_t neg_pwr = 0; // NEG_PWR cache, power-on default all unipolar
+
+    // Per channel decode: code = (raw ^ sign) - sign, signed for bipolar
+    uint16_t vbus_sign[CHANNELS];
+    uint16_t vsense_sign[CHANNELS];
+    float vbus_scale[CHANNELS];
+    float current_scale[CHANNELS];
+
+    int write_neg_pwr(uint8_t value);
+    void update_scales();
 };
 
-#endif /* PAC193x_H_ */
\ No newline at end of file
+extern template class pac193x_t<pac1931>;
+extern template class pac193x_t<pac1932>;
+extern template class pac193x_t<pac1933>;
+extern template class pac193x_t<pac1934>;
+
+using pac193x = pac193x_t<pac1933>;
+
+static_assert(is_sensor_v<pac193x>, "pac193x implements the sensor contract");
+
+#endif /* PAC193x_H_ */
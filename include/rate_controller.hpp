@@ -0,0 +1,135 @@
+/*
+ * File:     rate_controller.hpp
+ * Notes:    Activity adaptive sampling rate and precision per device
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef RATE_CONTROLLER_H_
+#define RATE_CONTROLLER_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include <functional>
+#include <vector>
+#include "sample.hpp"
+
+#define RATE_LEVELS_MAX 8
+#define RATE_WARMUP     5 // values of a channel before it counts
+
+/// @brief One rate and precision setting of a device, slowest first
+struct rate_level
+{
+    uint64_t period_us; // Read interval
+    const char *label;  // Shown in the log
+    float noise = 1.0f; // Measurement noise relative to the level the watch() noise is given for
+};
+
+/// @brief Moves every device along its ladder of rate_levels by the
+/// activity of the channels it watches.
+///
+/// Activity of a channel is the larger of its exponentially weighted
+/// standard deviation over the noise it is allowed to have, and its
+/// slope over the expected change rate. The slope is taken between
+/// points horizon_us apart so it doesn't depend on the sampling rate.
+/// Both allowances are those given to watch() times the noise of the
+/// current level, so the noise of a low precision level alone doesn't
+/// hold the device there.
+/// A device jumps to its upper bound as soon as the activity exceeds 1,
+/// a transient is caught at the fastest rate. It steps down one level
+/// after the activity stayed below 0.5 for dwell_us. Every change is
+/// applied through the callback of the device and logged.
+class rate_controller
+{
+public:
+    float alpha = 0.2f;             // EWMA weight of a new value
+    uint64_t horizon_us = 5000000;  // Slope base line
+    uint64_t dwell_us = 10000000;   // Calm time before one level down
+
+    // Statistics
+    uint32_t changes = 0; // Level changes applied
+
+    rate_controller(/* args */);
+    ~rate_controller();
+
+    /// @brief Register a device
+    /// @param alias Name used in the log
+    /// @param levels Ladder, slowest first, copied
+    /// @param n Number of levels
+    /// @param apply Configure the device for a level, <0 on failure
+    /// @return Device index, <0 on failure
+    int add(const char *alias, const rate_level *levels, int n, std::function<int(int)> apply);
+
+    /// @brief Restrict the levels of a device
+    void bounds(int dev, int lo, int hi);
+
+    /// @brief Let a channel drive a device
+    /// @param dev Device index
+    /// @param channel Channel id, see make_channel()
+    /// @param noise Allowed standard deviation at noise 1 [unit of the channel]
+    /// @param slope Expected change rate at noise 1 [unit per second]
+    void watch(int dev, uint32_t channel, float noise, float slope);
+
+    /// @brief Feed a value of a channel
+    /// @param channel Channel id
+    /// @param t Sample time [us]
+    /// @param value Physical value
+    void observe(uint32_t channel, uint64_t t, float value);
+
+    /// @brief Feed samples, converted with to_unit()
+    void push(const sample *s, size_t n);
+
+    /// @brief Evaluate all devices and apply changes, once per loop
+    /// @param now Monotonic time [us]
+    void update(uint64_t now);
+
+    /// @brief Apply a level right away
+    /// @return Action status, <0 on failure
+    int set_level(int dev, int level, uint64_t now);
+
+    /// @brief Device should be read now, advances its deadline. Half a
+    /// tick_us() early counts as due.
+    /// @param now Monotonic time [us]
+    bool due(int dev, uint64_t now);
+
+    /// @brief Smallest read interval over the current levels, the loop period
+    uint64_t tick_us() const;
+
+    int level(int dev) const { return devices[dev].level; }
+    float activity(int dev) const { return devices[dev].activity; }
+
+private:
+    struct device
+    {
+        const char *alias;
+        rate_level levels[RATE_LEVELS_MAX];
+        int n;
+        int lo, hi;               // bounds
+        int level;
+        std::function<int(int)> apply;
+        float activity;           // latest, max over the watched channels
+        uint64_t calm_since;      // activity below 0.5 since, 0 if not
+        uint64_t next;            // next read
+    };
+
+    struct channel_stats
+    {
+        uint32_t channel;
+        int dev;
+        float noise, slope;
+        uint32_t count;
+        float mean, var;          // EWMA
+        float rate;               // latest slope [unit/s]
+        uint64_t ref_t;           // slope base line
+        float ref_mean;
+        bool fresh;               // observed since the last update()
+    };
+
+    std::vector<device> devices;
+    std::vector<channel_stats> stats;
+};
+
+#endif /* RATE_CONTROLLER_H_ */
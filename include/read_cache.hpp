@@ -0,0 +1,111 @@
+/*
+ * File:     read_cache.hpp
+ * Notes:    Staleness bounded cache of a device reading, concurrent reads coalesced
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef READ_CACHE_H_
+#define READ_CACHE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include "clock.hpp"
+
+/// @brief Latest reading of one device for any number of consumers.
+/// get() returns the cached reading while it is young enough. Otherwise
+/// the first caller reads the device and every caller arriving during
+/// that read waits for it and shares its result, so the bus sees one
+/// transaction however many consumers there are. A reading is as old as
+/// the start of its bus read. Callers that joined a read get its result
+/// even if that read started before their max_age, at most one read
+/// earlier than asked.
+/// @tparam T Reading, copied out under the lock
+template <typename T>
+class read_cache
+{
+public:
+    std::function<int(T &)> fetch; // Bus read, <0 on failure
+
+    // Statistics
+    uint64_t hits = 0;     // Served from the cache
+    uint64_t reads = 0;    // Bus reads
+    uint64_t joined = 0;   // Callers that waited for a read of another caller
+    uint64_t failures = 0; // Failed bus reads
+
+    read_cache(std::function<int(T &)> fetch = nullptr) : fetch(fetch) {}
+
+    /// @brief Reading not older than max_age
+    /// @param max_age_us Oldest acceptable reading [us], 0 reads unless a read is running
+    /// @param out Destination
+    /// @return Action status of the bus read, <0 on failure
+    int get(uint64_t max_age_us, T &out)
+    {
+        std::unique_lock<std::mutex> lk(m);
+
+        if (valid && clk()->now_us() - stamp <= max_age_us)
+        {
+            hits++;
+            out = value;
+            return 0;
+        }
+        if (busy)
+        {
+            // The running read is newer than anything a new one could add
+            uint64_t gen = generation;
+            joined++;
+            cv.wait(lk, [&]() { return generation != gen; });
+            if (last_ret >= 0)
+                out = value;
+            return last_ret;
+        }
+
+        busy = true;
+        reads++;
+        uint64_t start = clk()->now_us();
+        lk.unlock();
+
+        T v;
+        int ret = fetch(v);
+
+        lk.lock();
+        if (ret >= 0)
+        {
+            value = v;
+            stamp = start;
+            valid = true;
+            out = v;
+        }
+        else
+            failures++;
+        last_ret = ret;
+        busy = false;
+        generation++;
+        cv.notify_all();
+        return ret;
+    }
+
+    /// @brief Forget the cached reading, e.g. after a configuration change
+    void invalidate()
+    {
+        std::lock_guard<std::mutex> lk(m);
+        valid = false;
+    }
+
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    T value{};
+    uint64_t stamp = 0;      // Start of the read that produced value
+    bool valid = false;
+    bool busy = false;       // A read is running
+    uint64_t generation = 0; // Completed reads, wakes the callers that joined
+    int last_ret = 0;
+};
+
+#endif /* READ_CACHE_H_ */
@@ -0,0 +1,261 @@
+/*
+ * File:     record.hpp
+ * Notes:    Typed fixed point records, native code with compile time scaling
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef RECORD_H_
+#define RECORD_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include "sample.hpp"
+
+/// @brief Fixed point format of a Kind: physical = code * scale + offset.
+/// Codes that need device calibration (MS5607) are not linear, their
+/// value is the code itself.
+template <Kind K>
+struct kind_traits
+{
+    using code_t = int32_t;
+    static constexpr float scale = 1.0f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = false;
+    static constexpr const char *unit = "";
+};
+
+template <>
+struct kind_traits<Kind::SHT3X_T>
+{
+    using code_t = uint16_t;
+    static constexpr float scale = 175.0f / 65535.0f;
+    static constexpr float offset = -45.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "°C";
+};
+
+template <>
+struct kind_traits<Kind::SHT3X_RH>
+{
+    using code_t = uint16_t;
+    static constexpr float scale = 100.0f / 65535.0f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "%";
+};
+
+template <>
+struct kind_traits<Kind::MS5607_D1>
+{
+    using code_t = uint32_t; // 24 bit, compensated by ms5607::compensate()
+    static constexpr float scale = 1.0f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = false;
+    static constexpr const char *unit = "";
+};
+
+template <>
+struct kind_traits<Kind::MS5607_D2> : kind_traits<Kind::MS5607_D1>
+{
+};
+
+// PAC193x unipolar codes, bipolar channels are converted by the driver
+template <>
+struct kind_traits<Kind::PAC_VBUS>
+{
+    using code_t = uint16_t;
+    static constexpr float scale = 32.0f / 65536.0f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "V";
+};
+
+template <>
+struct kind_traits<Kind::PAC_VSENSE>
+{
+    using code_t = uint16_t;
+    static constexpr float scale = 100000.0f / 65536.0f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "uV";
+};
+
+template <>
+struct kind_traits<Kind::DEW_POINT>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.01f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "°C";
+};
+
+template <>
+struct kind_traits<Kind::ABS_HUMIDITY>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.001f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "g/m³";
+};
+
+template <>
+struct kind_traits<Kind::AIR_DENSITY>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.000001f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "kg/m³";
+};
+
+template <>
+struct kind_traits<Kind::BARO_T>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.01f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "°C";
+};
+
+template <>
+struct kind_traits<Kind::BARO_P>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.01f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "mbar";
+};
+
+template <>
+struct kind_traits<Kind::ALTITUDE>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.001f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "m";
+};
+
+template <>
+struct kind_traits<Kind::VSPEED>
+{
+    using code_t = int32_t;
+    static constexpr float scale = 0.001f;
+    static constexpr float offset = 0.0f;
+    static constexpr bool linear = true;
+    static constexpr const char *unit = "m/s";
+};
+
+/// @brief Native code of one Kind, converted only when value() is asked.
+/// Two bytes for the 16 bit codes instead of a float plus its kind.
+template <Kind K>
+struct record
+{
+    using traits = kind_traits<K>;
+    using code_t = typename traits::code_t;
+
+    code_t code;
+
+    constexpr float value() const { return code * traits::scale + traits::offset; }
+
+    static constexpr record from(const sample &s) { return {(code_t)s.value}; }
+
+    /// @brief Nearest code of a physical value, e.g. for limits written to a device
+    static constexpr record of(float v) { return {(code_t)((v - traits::offset) / traits::scale + 0.5f)}; }
+};
+
+/// @brief Batch conversion, a plain multiply-add loop the compiler vectorizes
+template <Kind K>
+void convert(const record<K> *in, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = in[i].value();
+}
+
+/// @brief Scale of a Kind known only at run time
+struct unit_scale
+{
+    float scale;
+    float offset;
+    bool linear;
+    const char *unit;
+};
+
+template <Kind K>
+constexpr unit_scale make_unit_scale()
+{
+    return {kind_traits<K>::scale, kind_traits<K>::offset, kind_traits<K>::linear, kind_traits<K>::unit};
+}
+
+constexpr unit_scale kind_scale(Kind k)
+{
+    switch (k)
+    {
+    case Kind::SHT3X_T:
+        return make_unit_scale<Kind::SHT3X_T>();
+    case Kind::SHT3X_RH:
+        return make_unit_scale<Kind::SHT3X_RH>();
+    case Kind::MS5607_D1:
+        return make_unit_scale<Kind::MS5607_D1>();
+    case Kind::MS5607_D2:
+        return make_unit_scale<Kind::MS5607_D2>();
+    case Kind::PAC_VBUS:
+        return make_unit_scale<Kind::PAC_VBUS>();
+    case Kind::PAC_VSENSE:
+        return make_unit_scale<Kind::PAC_VSENSE>();
+    case Kind::DEW_POINT:
+        return make_unit_scale<Kind::DEW_POINT>();
+    case Kind::ABS_HUMIDITY:
+        return make_unit_scale<Kind::ABS_HUMIDITY>();
+    case Kind::AIR_DENSITY:
+        return make_unit_scale<Kind::AIR_DENSITY>();
+    case Kind::BARO_T:
+        return make_unit_scale<Kind::BARO_T>();
+    case Kind::BARO_P:
+        return make_unit_scale<Kind::BARO_P>();
+    case Kind::ALTITUDE:
+        return make_unit_scale<Kind::ALTITUDE>();
+    case Kind::VSPEED:
+        return make_unit_scale<Kind::VSPEED>();
+    default:
+        return make_unit_scale<Kind::NONE>();
+    }
+}
+
+/// @brief Physical value of a sample
+/// @param s Sample
+/// @return Value in kind_scale().unit, the code for non linear kinds
+inline float to_unit(const sample &s)
+{
+    unit_scale u = kind_scale(channel_kind(s.channel));
+    return s.value * u.scale + u.offset;
+}
+
+/// @brief Physical values of samples, one lookup per run of equal channels
+/// @param s Samples
+/// @param out Values
+/// @param n Number of samples
+inline void to_unit(const sample *s, float *out, size_t n)
+{
+    uint32_t channel = ~0u;
+    unit_scale u = {1.0f, 0.0f, false, ""};
+    for (size_t i = 0; i < n; i++)
+    {
+        if (s[i].channel != channel)
+        {
+            channel = s[i].channel;
+            u = kind_scale(channel_kind(channel));
+        }
+        out[i] = s[i].value * u.scale + u.offset;
+    }
+}
+
+#endif /* RECORD_H_ */
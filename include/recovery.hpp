@@ -0,0 +1,110 @@
+/*
+ * File:     recovery.hpp
+ * Notes:    Per-device fault recovery state machine
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef RECOVERY_H_
+#define RECOVERY_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <functional>
+#include "i_i2c.hpp"
+
+/// @brief Recovery of a single device after failed transactions.
+/// The machine never sleeps: poll() does at most one bus action and
+/// returns, so other devices on the same bus keep being served while
+/// this one waits for its reset to settle or for its backoff to expire.
+///
+/// Sequence per attempt: soft reset (odd attempts) or I2C general call
+/// reset (even attempts), settle, probe. A failed probe doubles the
+/// backoff up to backoff_max_us. After max_retries the device is OFFLINE
+/// until rearm() is called.
+/// Note: the general call reset also resets every other device on the
+/// bus that honours it, their own probes will fail and recover them.
+class recovery
+{
+public:
+    enum class State : uint8_t
+    {
+        ONLINE,       // device serving data
+        SOFT_RESET,   // device soft reset pending
+        GENERAL_CALL, // general call reset pending
+        SETTLE,       // waiting for reset to complete
+        BACKOFF,      // waiting before next attempt
+        OFFLINE       // retries exhausted
+    };
+
+    const char *alias = "DEV";    // Name used in log messages
+    i_i2c *i2c = nullptr;         // Bus used for general call reset
+
+    std::function<int()> soft_reset; // Send soft reset command, <0 on failure
+    std::function<int()> probe;      // Check device and re-init it, <0 on failure
+
+    uint8_t fault_threshold = 3;      // Consecutive failures before recovery starts
+    uint8_t max_retries = 8;          // Attempts before going OFFLINE
+    uint32_t settle_us = 2000;        // Time between reset and probe
+    uint32_t backoff_min_us = 10000;  // First backoff
+    uint32_t backoff_max_us = 5000000;// Backoff cap
+
+    // Availability statistics
+    uint32_t outages = 0;        // Completed outages
+    uint64_t downtime_us = 0;    // Total time unavailable over completed outages
+    uint64_t last_outage_us = 0; // Duration of the last completed outage
+
+    recovery(/* args */);
+    ~recovery();
+
+    /// @brief Report a successful transaction
+    void success();
+
+    /// @brief Report a failed transaction
+    /// @param now Monotonic time [us]
+    void fault(uint64_t now);
+
+    /// @brief Advance the state machine, never blocks
+    /// @param now Monotonic time [us]
+    /// @return Current state
+    State poll(uint64_t now);
+
+    /// @brief Restart recovery of an OFFLINE device
+    /// @param now Monotonic time [us]
+    void rearm(uint64_t now);
+
+    /// @brief Bring up a device that was just added, the same way as a
+    /// recovery but with soft resets only, so the devices already running
+    /// on the bus are not reset. Not counted as an outage.
+    /// @param now Monotonic time [us]
+    void start(uint64_t now);
+
+    /// @brief Device may be accessed
+    bool available() const { return state == State::ONLINE; }
+
+    /// @brief Current state
+    State get_state() const { return state; }
+
+    /// @brief Time spent unavailable in the current outage
+    /// @param now Monotonic time [us]
+    /// @return Duration [us], 0 if online
+    uint64_t unavailable_us(uint64_t now) const;
+
+    static const char *state_name(State s);
+
+private:
+    State state = State::ONLINE;
+    uint8_t failures = 0;     // Consecutive failed transactions
+    uint8_t attempt = 0;      // Recovery attempt in current outage
+    uint32_t backoff_us = 0;  // Current backoff
+    uint64_t deadline = 0;    // Time of the next action
+    uint64_t down_since = 0;  // Start of the current outage
+    bool starting = false;    // Bring-up by start(), not an outage
+
+    void set_state(State s);
+    void next_attempt(uint64_t now);
+};
+
+#endif /* RECOVERY_H_ */
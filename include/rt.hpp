@@ -0,0 +1,61 @@
+/*
+ * File:     rt.hpp
+ * Notes:    Real-time acquisition setup and sampling jitter statistics
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef RT_H_
+#define RT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+
+/// @brief Real-time options of the bus thread
+struct rt_config
+{
+    int priority = 0;                  // SCHED_FIFO priority 1..99, 0 = normal scheduling
+    int cpu = -1;                      // CPU to pin to, -1 = any
+    size_t stack_prefault = 256 * 1024;// Stack bytes touched up front
+};
+
+/// @brief Make the calling thread real-time: lock all memory, keep malloc
+/// from giving pages back, pre-fault the stack, then apply CPU affinity
+/// and SCHED_FIFO priority.
+/// @param cfg Options
+/// @return Action status, <0 if any step failed (the others are kept)
+int rt_setup(const rt_config &cfg);
+
+#define JITTER_BINS 24
+
+/// @brief Histogram of sampling period deviations.
+/// Bin k holds |deviation| in [2^(k-1), 2^k) us, bin 0 is below 1 us.
+class jitter_histogram
+{
+public:
+    uint64_t period_us; // Nominal period
+
+    jitter_histogram(uint64_t period = 0);
+
+    /// @brief Record the start time of a sampling cycle
+    /// @param t Monotonic time [us]
+    void tick(uint64_t t);
+
+    /// @brief Print statistics and histogram
+    void report(const char *alias) const;
+
+    uint64_t count = 0; // periods recorded
+    int64_t min = 0;    // [us]
+    int64_t max = 0;    // [us]
+    double sum = 0;
+    double sum2 = 0;
+    uint64_t bins[JITTER_BINS] = {0};
+
+private:
+    uint64_t last = 0;
+};
+
+#endif /* RT_H_ */
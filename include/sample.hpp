@@ -0,0 +1,64 @@
+/*
+ * File:     sample.hpp
+ * Notes:    Timestamped raw sample shared by storage and transport
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SAMPLE_H_
+#define SAMPLE_H_
+
+#include "stdint.h"
+#include "clock.hpp"
+
+/// @brief Measured quantity, native device code or derived fixed point
+enum class Kind : uint8_t
+{
+    NONE,
+    SHT3X_T,      // SHT3x temperature code, 16 bit
+    SHT3X_RH,     // SHT3x humidity code, 16 bit
+    MS5607_D1,    // MS5607 digital pressure, 24 bit
+    MS5607_D2,    // MS5607 digital temperature, 24 bit
+    PAC_VBUS,     // PAC193x bus voltage code, 16 bit, index = channel
+    PAC_VSENSE,   // PAC193x sense voltage code, 16 bit, index = channel
+    DEW_POINT,    // Derived dew point [0.01 °C]
+    ABS_HUMIDITY, // Derived absolute humidity [mg/m³]
+    AIR_DENSITY,  // Derived moist air density [mg/m³]
+    BARO_T,       // Compensated barometer temperature [0.01 °C], e.g. from IIO
+    BARO_P,       // Compensated barometric pressure [0.01 mbar], e.g. from IIO
+    ALTITUDE,     // Filtered barometric altitude [mm]
+    VSPEED        // Vertical speed [mm/s]
+};
+
+/// @brief Sample with the raw device code, conversion is left to consumers
+struct sample
+{
+    uint64_t timestamp; // [us] since epoch
+    uint32_t channel;   // see make_channel()
+    int32_t value;      // native code
+};
+
+/// @brief Build channel id
+/// @param node Device node, see i_i2c::node()
+/// @param kind Quantity
+/// @param index Sub channel, e.g. PAC193x channel
+/// @return node << 16 | kind << 8 | index
+inline uint32_t make_channel(uint16_t node, Kind kind, uint8_t index = 0)
+{
+    return (uint32_t)node << 16 | (uint32_t)kind << 8 | index;
+}
+
+inline uint16_t channel_node(uint32_t channel) { return channel >> 16; }
+inline Kind channel_kind(uint32_t channel) { return (Kind)((channel >> 8) & 0xFF); }
+inline uint8_t channel_index(uint32_t channel) { return channel & 0xFF; }
+
+/// @brief Wall clock time for sample timestamps
+/// @return [us] since epoch
+inline uint64_t sample_time()
+{
+    return clk()->wall_us();
+}
+
+#endif /* SAMPLE_H_ */
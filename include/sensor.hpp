@@ -0,0 +1,256 @@
+/*
+ * File:     sensor.hpp
+ * Notes:    Compile time sensor contract and a scheduler over it
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SENSOR_H_
+#define SENSOR_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "clock.hpp"
+#include "sample.hpp"
+
+/// @brief Result of a contract step, the same for every driver.
+/// Negative values are failures.
+enum class Status : int8_t
+{
+    OK = 0,
+    PENDING = 1,  // More to do, fetch() again after ready_us()
+    IO = -1,      // Transfer failed or NACK
+    CRC = -2,     // Checksum mismatch
+    INVALID = -3, // Implausible data, e.g. conversion interrupted
+    STATE = -4    // fetch() without trigger()
+};
+
+inline bool failed(Status s) { return (int8_t)s < 0; }
+
+inline const char *status_name(Status s)
+{
+    switch (s)
+    {
+    case Status::OK:
+        return "OK";
+    case Status::PENDING:
+        return "PENDING";
+    case Status::IO:
+        return "IO";
+    case Status::CRC:
+        return "CRC";
+    case Status::INVALID:
+        return "INVALID";
+    case Status::STATE:
+        return "STATE";
+    }
+    return "?";
+}
+
+/// @brief Detects the sensor contract:
+///
+///     Status trigger();        Start a measurement
+///     uint32_t ready_us() const;   Time until fetch() may be called [us]
+///     Status fetch();          Collect the result, PENDING for another round
+///     size_t decode(uint64_t ts, sample *out, size_t max) const;
+///                              Samples of the last result, 0 if they don't fit
+///     static constexpr size_t SENSOR_SAMPLES;  Samples of one result
+template <typename T, typename = void>
+struct is_sensor : std::false_type
+{
+};
+
+template <typename T>
+struct is_sensor<T, std::void_t<
+    std::enable_if_t<std::is_same<decltype(std::declval<T &>().trigger()), Status>::value>,
+    std::enable_if_t<std::is_same<decltype(std::declval<T &>().fetch()), Status>::value>,
+    std::enable_if_t<std::is_convertible<decltype(std::declval<const T &>().ready_us()), uint32_t>::value>,
+    std::enable_if_t<std::is_same<decltype(std::declval<const T &>().decode(uint64_t(), (sample *)nullptr, size_t())), size_t>::value>,
+    std::enable_if_t<std::is_convertible<decltype(T::SENSOR_SAMPLES), size_t>::value>>> : std::true_type
+{
+};
+
+template <typename T>
+constexpr bool is_sensor_v = is_sensor<T>::value;
+
+/// @brief Mixin for drivers implementing the contract, adds the
+/// blocking sequence on top of the driver's own steps. No virtual
+/// functions, every call is resolved at compile time.
+template <typename Derived>
+class sensor
+{
+public:
+    /// @brief Trigger, wait, fetch until complete and decode
+    /// @param ts Sample timestamp
+    /// @param out Samples
+    /// @param max Capacity of out
+    /// @param n Number of samples, 0 on failure
+    /// @return Status of the failing step or OK
+    Status measure(uint64_t ts, sample *out, size_t max, size_t &n)
+    {
+        static_assert(is_sensor_v<Derived>, "Derived doesn't implement the sensor contract");
+        Derived &d = static_cast<Derived &>(*this);
+
+        n = 0;
+        Status s = d.trigger();
+        while (not failed(s))
+        {
+            uint32_t wait = d.ready_us();
+            if (wait)
+                clk()->sleep_us(wait);
+            s = d.fetch();
+            if (s == Status::OK)
+            {
+                n = d.decode(ts, out, max);
+                break;
+            }
+        }
+        return s;
+    }
+
+protected:
+    sensor() {}
+};
+
+/// @brief Schedules a fixed set of sensors of any types implementing the
+/// contract. Each sensor is triggered on its own period and fetched at
+/// its ready deadline, so conversions of different devices overlap and
+/// nothing sleeps. The set is a tuple, poll() unrolls into direct calls.
+template <typename... Sensors>
+class sensor_scheduler
+{
+    static_assert((is_sensor_v<Sensors> && ...), "Every type has to implement the sensor contract");
+
+public:
+    static constexpr size_t SIZE = sizeof...(Sensors);
+
+    uint64_t period_us[SIZE]; // Trigger interval per sensor, 1 s unless set
+
+    // Statistics per sensor
+    uint32_t errors[SIZE];
+    uint32_t dropped[SIZE]; // Results that didn't fit into out
+    Status last[SIZE];      // Last failure or OK
+
+    sensor_scheduler(Sensors *...s) : sensors(s...)
+    {
+        for (size_t i = 0; i < SIZE; i++)
+        {
+            period_us[i] = 1000000;
+            errors[i] = 0;
+            dropped[i] = 0;
+            last[i] = Status::OK;
+            busy[i] = false;
+            next[i] = 0;
+            deadline[i] = 0;
+            trigger_ts[i] = 0;
+        }
+    }
+
+    /// @brief Trigger due sensors and fetch those that are ready
+    /// @param now Monotonic time [us]
+    /// @param ts Sample timestamp of triggers in this call
+    /// @param out Samples, stamped with the time of their trigger
+    /// @param max Capacity of out
+    /// @return Number of samples
+    size_t poll(uint64_t now, uint64_t ts, sample *out, size_t max)
+    {
+        return poll_all(now, ts, out, max, std::index_sequence_for<Sensors...>());
+    }
+
+    /// @brief Monotonic time of the next trigger or fetch [us]
+    uint64_t next_deadline() const
+    {
+        uint64_t t = UINT64_MAX;
+        for (size_t i = 0; i < SIZE; i++)
+        {
+            uint64_t d = busy[i] ? deadline[i] : next[i];
+            t = d < t ? d : t;
+        }
+        return t;
+    }
+
+    /// @brief Drop running measurements, trigger every sensor at at first
+    /// @param at Monotonic time [us]
+    void restart(uint64_t at)
+    {
+        for (size_t i = 0; i < SIZE; i++)
+        {
+            busy[i] = false;
+            next[i] = at;
+        }
+    }
+
+    /// @brief Sensor by position
+    template <size_t I>
+    auto &get() { return *std::get<I>(sensors); }
+
+private:
+    std::tuple<Sensors *...> sensors;
+    bool busy[SIZE];           // Triggered, waiting for the deadline
+    uint64_t next[SIZE];       // Next trigger
+    uint64_t deadline[SIZE];   // Next fetch
+    uint64_t trigger_ts[SIZE]; // Timestamp of the running measurement
+
+    template <size_t... I>
+    size_t poll_all(uint64_t now, uint64_t ts, sample *out, size_t max, std::index_sequence<I...>)
+    {
+        size_t n = 0;
+        ((n += step<I>(now, ts, out + n, max - n)), ...);
+        return n;
+    }
+
+    template <size_t I>
+    size_t step(uint64_t now, uint64_t ts, sample *out, size_t max)
+    {
+        auto &s = *std::get<I>(sensors);
+
+        if (not busy[I] && now >= next[I])
+        {
+            // Keep the phase, skip periods that were missed
+            next[I] += period_us[I];
+            if (next[I] <= now)
+                next[I] = now + period_us[I];
+
+            Status st = s.trigger();
+            if (failed(st))
+                return fail(I, st);
+            busy[I] = true;
+            deadline[I] = now + s.ready_us();
+            trigger_ts[I] = ts;
+        }
+        if (not busy[I] || now < deadline[I])
+            return 0;
+
+        Status st = s.fetch();
+        if (st == Status::PENDING)
+        {
+            deadline[I] = now + s.ready_us();
+            return 0;
+        }
+        busy[I] = false;
+        if (failed(st))
+            return fail(I, st);
+        last[I] = st;
+
+        size_t n = s.decode(trigger_ts[I], out, max);
+        if (n == 0)
+            dropped[I]++;
+        return n;
+    }
+
+    size_t fail(size_t i, Status st)
+    {
+        busy[i] = false;
+        errors[i]++;
+        last[i] = st;
+        return 0;
+    }
+};
+
+#endif /* SENSOR_H_ */
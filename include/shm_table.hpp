@@ -0,0 +1,135 @@
+/*
+ * File:     shm_table.hpp
+ * Notes:    Shared memory latest-value table, publisher and reader
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SHM_TABLE_H_
+#define SHM_TABLE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "sample.hpp"
+
+#define SHM_MAGIC   0x3154564C // "LVT1"
+#define SHM_VERSION 1
+#define SHM_NAME    "/sht3x-latest"
+#define SHM_SLOTS   256
+#define SHM_SPINS   64   // seqlock retries between yields of a reader
+#define SHM_RETRIES 4096 // seqlock retries before a reader gives up on a stuck publisher
+
+/// @brief Table header, seq is a seqlock over whole published batches
+struct alignas(64) shm_header
+{
+    uint32_t magic;   // written last when the table is ready
+    uint32_t version;
+    uint32_t slots;   // capacity
+    uint32_t used;    // slots in use, slots never move once assigned
+    uint32_t seq;     // odd while a batch is being written
+    uint32_t owner;   // pid of the publisher
+    uint32_t epoch;   // incremented by every Open(), a reset in place changes it
+};
+
+/// @brief One channel, seq is a seqlock over this slot only
+struct alignas(64) shm_slot
+{
+    uint32_t seq;
+    uint32_t channel;
+    uint64_t timestamp;
+    int32_t value;
+    uint32_t updates; // publish counter, lets readers spot missed values
+};
+
+/// @brief Owner side: the acquisition process publishes the latest samples.
+/// Publishing never blocks and never makes a syscall.
+class shm_publisher
+{
+public:
+    std::string name = SHM_NAME; // Name under /dev/shm
+    uint32_t slots = SHM_SLOTS;
+
+    shm_publisher(/* args */);
+    ~shm_publisher();
+
+    /// @brief Create and map the table
+    /// @return Action status, <0 on failure
+    int Open();
+
+    /// @brief Unmap and remove the table
+    void Close();
+
+    /// @brief Publish one sample
+    /// @return Action status, <0 when the table is full
+    int publish(const sample &s);
+
+    /// @brief Publish samples as one batch, readers see all or none of them
+    /// @return Number of samples published
+    size_t publish(const sample *s, size_t n);
+
+private:
+    shm_header *hdr = nullptr;
+    shm_slot *table = nullptr;
+    size_t size = 0;
+    std::unordered_map<uint32_t, uint32_t> index; // channel -> slot
+
+    shm_slot *slot(uint32_t channel);
+    void write(shm_slot *sl, const sample &s);
+};
+
+/// @brief Reader side: lock-free consistent reads from any process.
+/// Reads are plain memory accesses retried while the publisher is
+/// writing, nothing is allocated after Open(). Every read checks that
+/// the publisher seen by Open() still owns the table and re-opens it
+/// when the publisher closed or restarted, only then syscalls are made.
+class shm_reader
+{
+public:
+    std::string name = SHM_NAME; // Name under /dev/shm
+
+    shm_reader(/* args */);
+    ~shm_reader();
+
+    /// @brief Map the table read-only
+    /// @return Action status, <0 if no publisher has created it
+    int Open();
+
+    void Close();
+
+    /// @brief Latest sample of one channel
+    /// @param channel Channel id
+    /// @param s Destination
+    /// @return true if the channel was published, false without a publisher
+    /// or when the publisher stopped in the middle of a write
+    bool get(uint32_t channel, sample &s);
+
+    /// @brief Consistent copy of all channels from one published batch
+    /// @param out Destination
+    /// @param max Capacity of out, SHM_SLOTS holds a default table
+    /// @return Number of channels, 0 without a publisher or a torn batch
+    size_t snapshot(sample *out, size_t max);
+
+private:
+    const shm_header *hdr = nullptr;
+    const shm_slot *table = nullptr;
+    size_t size = 0;
+    uint32_t owner = 0;            // Publisher and epoch the mapping belongs to
+    uint32_t epoch = 0;
+    uint32_t indexed = 0;
+    std::vector<uint32_t> lookup;  // Open addressing, slot + 1 by channel hash, sized by Open()
+    uint32_t mask = 0;
+
+    bool owned() const;
+    bool current();
+    void reindex();
+    const shm_slot *find(uint32_t channel) const;
+    bool backoff(uint32_t &tries) const;
+    bool read(const shm_slot *sl, sample &s);
+};
+
+#endif /* SHM_TABLE_H_ */
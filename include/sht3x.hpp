@@ -13,6 +13,8 @@
 #include "stdint.h"
 #include "stdbool.h"
 #include "i_i2c.hpp"
+#include "sensor.hpp"
+#include "read_cache.hpp"
 
 /// @brief Data acquisition frequency (0.5, 1, 2, 4 & 10 measurements per second, mps)
 enum class Frequency : uint8_t
@@ -33,7 +35,17 @@ enum class Repeatability : uint8_t
     LOW
 };
 
-class sht3x
+/// @brief ALERT limits, the pin is set above HIGH_SET or below LOW_SET
+/// and cleared again between HIGH_CLEAR and LOW_CLEAR
+enum class AlertLimit : uint8_t
+{
+    HIGH_SET,
+    HIGH_CLEAR,
+    LOW_CLEAR,
+    LOW_SET
+};
+
+class sht3x : public sensor<sht3x>
 {
     // definition of possible I2C slave addresses
     #define ADDR_1 0x44 // ADDR pin connected to GND/VSS (default)
@@ -64,10 +76,13 @@ class sht3x
     #define MEAS_DURATION_MED   6
     #define MEAS_DURATION_LOW   4
 
+    #define RESET_DURATION_US   1500 // max time from soft reset ACK to idle state
+
     #define RAW_DATA_SIZE       6
     typedef uint8_t raw_data_t[RAW_DATA_SIZE];
 
-    const uint16_t MEASURE_CMD[6][3] = {
+    // Shared by all instances, a fleet of sensors keeps only its state
+    static constexpr uint16_t MEASURE_CMD[6][3] = {
         {0x2400, 0x240b, 0x2416},  // [SINGLE_SHOT][H,M,L] without clock stretching
         {0x2032, 0x2024, 0x202f},  // [PERIODIC_05][H,M,L]
         {0x2130, 0x2126, 0x212d},  // [PERIODIC_1 ][H,M,L]
@@ -76,33 +91,110 @@ class sht3x
         {0x2737, 0x2721, 0x272a}}; // [PERIODIC_10][H,M,L]
 
     // measurement durations in us
-    const uint16_t MEAS_DURATION_US[3] = {MEAS_DURATION_HIGH * 1000,
+    static constexpr uint16_t MEAS_DURATION_US[3] = {MEAS_DURATION_HIGH * 1000,
                                           MEAS_DURATION_MED  * 1000,
                                           MEAS_DURATION_LOW  * 1000};
 
+    // [HIGH_SET, HIGH_CLEAR, LOW_CLEAR, LOW_SET]
+    static constexpr uint16_t ALERT_WRITE_CMD[4] = {0x611D, 0x6116, 0x610B, 0x6100};
+    static constexpr uint16_t ALERT_READ_CMD[4] = {0xE11F, 0xE114, 0xE109, 0xE102};
+
 private:
-    const uint8_t g_polynom = 0x31;
-    Frequency mode;
-    bool started;
+    static constexpr uint8_t g_polynom = 0x31;
+    Frequency mode = Frequency::SINGLE_SHOT;
+    bool started = false;
+    raw_data_t result; // Last fetch()
+
+    int check_data(raw_data_t raw_data);
 
 public:
+    static constexpr size_t SENSOR_SAMPLES = 2; // SHT3X_T, SHT3X_RH
+
     i_i2c *i2c;
+    Repeatability single_rept = Repeatability::HIGH; // Single shot repeatability of trigger()
+
+    struct raw_result
+    {
+        raw_data_t raw;
+    };
+    read_cache<raw_result> results; // Latest result, shared by get_results() with max_age_us
 
     sht3x(/* args */);
     ~sht3x();
 
     void init();
     void reset();
-    void get_status();
+
+    /// @brief Send soft reset command without waiting for the device
+    /// @return Action status, <0 on failure
+    int soft_reset();
+
+    /// @brief Read and check status register
+    /// @return Action status, <0 on failure
+    int get_status();
     void clear_status();
     int start(Frequency frq, Repeatability rept);
     int single(float *temperature, float *humidity);
-    uint8_t crc8(uint8_t *arr, int size);
+    static uint8_t crc8(const uint8_t *arr, int size);
     void parse_data(raw_data_t raw_data, float *temperature, float *humidity);
     int get_results (float* temperature, float* humidity);
+
+    /// @brief Latest result shared by all callers, concurrent callers wait
+    /// for one fetch instead of each reading the device. Periodic modes only.
+    /// @param temperature [°C]
+    /// @param humidity [%]
+    /// @param max_age_us Oldest acceptable result [us]
+    /// @return Action status, <0 on failure
+    int get_results (float* temperature, float* humidity, uint64_t max_age_us);
     int get_data(raw_data_t raw_data);
+
+    /// @brief Read single shot result without a command, as the datasheet
+    /// requires after a single shot without clock stretching
+    /// @param raw_data Destination
+    /// @return Action status, <0 on failure or if not ready (NACK)
+    int read_single(raw_data_t raw_data);
+
+    /// @brief Measurement command, for transactions built outside the driver
+    static constexpr uint16_t measure_cmd(Frequency frq, Repeatability rept) { return MEASURE_CMD[(uint8_t)frq][(uint8_t)rept]; }
+
+    /// @brief Single shot command, for triggers built outside the driver
+    static constexpr uint16_t single_cmd(Repeatability rept) { return MEASURE_CMD[0][(uint8_t)rept]; }
+
+    /// @brief Measurement duration [us]
+    static constexpr uint32_t duration_us(Repeatability rept) { return MEAS_DURATION_US[(uint8_t)rept]; }
+
+    /// @brief Set an ALERT limit. The device compares the upper 9 bits of
+    /// the temperature and the upper 7 bits of the humidity code, so the
+    /// limit is rounded to about 0.34 °C and 0.8 %. Only periodic
+    /// measurements are compared.
+    /// @param which Limit
+    /// @param temperature [°C]
+    /// @param humidity [%]
+    /// @return Action status, <0 on failure
+    int set_alert_limit(AlertLimit which, float temperature, float humidity);
+
+    /// @brief Read an ALERT limit
+    /// @param which Limit
+    /// @param temperature [°C], lower edge of the 9 bit step
+    /// @param humidity [%], lower edge of the 7 bit step
+    /// @return Action status, <0 on failure
+    int get_alert_limit(AlertLimit which, float *temperature, float *humidity);
+
+    /// @brief Limit word of the alert commands, humidity in bits 15:9,
+    /// temperature in bits 8:0
+    static constexpr uint16_t alert_word(uint16_t t_code, uint16_t rh_code) { return (rh_code & 0xFE00) | (t_code >> 7); }
     void sleep (Repeatability rept);
     int stop();
+
+    /// @brief Sensor contract. In a periodic mode started with start()
+    /// trigger() does nothing and fetch() takes the latest result,
+    /// otherwise trigger() starts a single shot of single_rept.
+    Status trigger();
+    uint32_t ready_us() const;
+    Status fetch();
+    size_t decode(uint64_t ts, sample *out, size_t max) const;
 };
 
+static_assert(is_sensor_v<sht3x>, "sht3x implements the sensor contract");
+
 #endif /* SHT3x_H_ */
\ No newline at end of file
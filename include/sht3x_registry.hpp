@@ -0,0 +1,97 @@
+/*
+ * File:     sht3x_registry.hpp
+ * Notes:    Structure-of-arrays registry for large SHT3x fleets
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SHT3X_REGISTRY_H_
+#define SHT3X_REGISTRY_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include <vector>
+#include "i_i2c.hpp"
+#include "sht3x.hpp"
+#include "sample.hpp"
+
+#define REGISTRY_BATCH   21 // devices per combined transaction, 42 messages is the kernel limit
+#define REGISTRY_IDLE    UINT64_MAX
+
+/// @brief SHT3x fleet without an object per sensor. Per-device state is
+/// kept in one array per field, a fleet-wide poll walks the deadline
+/// column and touches the other columns only for due devices. Commands
+/// and timings come from the static sht3x tables.
+///
+/// Devices are addressed through one interface per bus (or mux channel),
+/// the address of the message is taken from the registry. Due devices on
+/// the same bus are fetched REGISTRY_BATCH at a time in one combined
+/// transaction. If it fails, the batch is repeated device by device so
+/// the error is counted for the device that caused it.
+class sht3x_registry
+{
+public:
+    std::vector<i_i2c *> buses; // Interfaces, index used by add()
+
+    // Dense per-device state, index from add()
+    std::vector<uint8_t> bus;         // Index into buses
+    std::vector<uint8_t> address;     // Slave address
+    std::vector<Frequency> mode;      // Last started mode
+    std::vector<Repeatability> rept;  // Last started repeatability
+    std::vector<uint64_t> deadline;   // Next result [us], REGISTRY_IDLE if none
+    std::vector<uint32_t> period_us;  // Periodic mode interval, 0 in single shot
+    std::vector<uint16_t> errors;     // Consecutive failures
+    std::vector<uint32_t> failures;   // Total failures
+    std::vector<uint16_t> t_code;     // Last temperature code
+    std::vector<uint16_t> rh_code;    // Last humidity code
+
+    sht3x_registry(/* args */);
+    ~sht3x_registry();
+
+    /// @brief Register device
+    /// @param b Bus index
+    /// @param addr Slave address
+    /// @return Device index
+    size_t add(uint8_t b, uint8_t addr);
+
+    size_t size() const { return address.size(); }
+
+    /// @brief Start measurements on all devices, single shot or periodic
+    /// @param frq Frequency
+    /// @param rpt Repeatability
+    /// @return Number of failed devices
+    size_t start(Frequency frq, Repeatability rpt);
+
+    /// @brief Stop periodic measurements on all devices
+    /// @return Number of failed devices
+    size_t stop();
+
+    /// @brief Soft reset all devices
+    /// @return Number of failed devices
+    size_t soft_reset();
+
+    /// @brief Fetch the results of every device that is due
+    /// @param now Monotonic time [us]
+    /// @param out Samples, temperature and humidity code per device
+    /// @param max Capacity of out, due devices that don't fit wait
+    /// @return Number of samples
+    size_t poll(uint64_t now, sample *out, size_t max);
+
+    /// @brief Earliest deadline over the fleet
+    /// @return [us], REGISTRY_IDLE if nothing is running
+    uint64_t next_deadline() const;
+
+private:
+    std::vector<size_t> pending;  // Due devices per bus, REGISTRY_BATCH each
+    std::vector<uint8_t> npending;
+
+    int command(size_t i, uint16_t cmd);
+    int fetch(uint8_t b, const size_t *idx, size_t n, uint8_t (*raw)[RAW_DATA_SIZE]);
+    size_t flush(uint8_t b, uint64_t now, uint64_t ts, sample *out);
+    void advance(size_t i, uint64_t now);
+};
+
+#endif /* SHT3X_REGISTRY_H_ */
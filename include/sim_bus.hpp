@@ -0,0 +1,177 @@
+/*
+ * File:     sim_bus.hpp
+ * Notes:    Simulated I2C bus with SHT3x, MS5607 and PAC193x models
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SIM_BUS_H_
+#define SIM_BUS_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <vector>
+#include "i_i2c.hpp"
+#include "clock.hpp"
+#include "events.hpp"
+
+class sim_tca9548a;
+
+/// @brief Simulated slave, time comes from clk()
+class sim_device
+{
+public:
+    uint8_t address;
+    sim_tca9548a *mux = nullptr; // Mux the device is behind
+    uint8_t mux_channel = 0;
+
+    virtual ~sim_device() {}
+
+    /// @brief Master write, <0 to NACK
+    virtual int write(const uint8_t *buf, uint16_t len) = 0;
+
+    /// @brief Master read, <0 to NACK
+    virtual int read(uint8_t *buf, uint16_t len) = 0;
+
+    /// @brief General call (address 0x00) command
+    virtual void general_call(const uint8_t * /*buf*/, uint16_t /*len*/) {}
+
+    /// @brief First ALERT pin edge in (after, until]. Time only moves
+    /// forward, the state up to after is final.
+    /// @param rising Direction of the edge
+    /// @return Edge time [us], UINT64_MAX if none
+    virtual uint64_t next_edge(uint64_t /*after*/, uint64_t /*until*/, bool & /*rising*/) { return UINT64_MAX; }
+};
+
+/// @brief SHT3x with single shot and periodic modes.
+/// Slow daily temperature and humidity cycle plus small noise.
+/// ALERT follows the limits at every periodic measurement, compared
+/// without the noise.
+class sim_sht3x : public sim_device
+{
+public:
+    sim_sht3x(uint8_t addr);
+    int write(const uint8_t *buf, uint16_t len) override;
+    int read(uint8_t *buf, uint16_t len) override;
+    void general_call(const uint8_t *buf, uint16_t len) override;
+    uint64_t next_edge(uint64_t after, uint64_t until, bool &rising) override;
+
+private:
+    uint16_t cmd = 0;           // last command
+    bool periodic = false;
+    uint64_t period_us = 0;
+    uint64_t period_start = 0;
+    uint64_t fetched = 0;       // periodic measurements fetched
+    uint64_t single_ready = 0;  // single shot result time, 0 = none
+    uint16_t status = 0x8010;   // alert pending, reset detected
+    uint32_t noise = 1;
+    uint16_t limit[4] = {0xCD33, 0xC92D, 0x3869, 0x3266}; // datasheet defaults, AlertLimit order
+    bool alert = false;         // ALERT pin
+    uint64_t alert_at = 0;      // measurement the pin state is final for
+    uint64_t edge_at = 0;       // edge returned last by next_edge()
+
+    void measurement(uint8_t *buf, uint64_t t);
+    bool alert_level(uint64_t t, bool state) const;
+    uint64_t next_measurement(uint64_t t) const;
+};
+
+/// @brief MS5607 with PROM, conversion timing per OSR and ADC read.
+/// Reading the ADC before the conversion is done returns 0, as the chip does.
+class sim_ms5607 : public sim_device
+{
+public:
+    sim_ms5607(uint8_t addr);
+    int write(const uint8_t *buf, uint16_t len) override;
+    int read(uint8_t *buf, uint16_t len) override;
+
+private:
+    uint16_t prom[8];
+    uint8_t cmd = 0;
+    uint64_t conv_done = 0;  // conversion end time
+    uint32_t conv_value = 0; // result of the running conversion
+    uint32_t noise = 1;
+    uint32_t adc = 0;        // result ready for ADC read
+};
+
+/// @brief PAC193x register file with REFRESH, REFRESH_G and auto increment reads.
+/// With ALERT_CC the ALERT pin pulses low at the CTRL sample rate.
+class sim_pac193x : public sim_device
+{
+public:
+    sim_pac193x(uint8_t addr, uint8_t product_id = 0x5A);
+    int write(const uint8_t *buf, uint16_t len) override;
+    int read(uint8_t *buf, uint16_t len) override;
+    void general_call(const uint8_t *buf, uint16_t len) override;
+    uint64_t next_edge(uint64_t after, uint64_t until, bool &rising) override;
+
+private:
+    uint8_t regs[256];     // single byte registers
+    uint8_t wide[256][6];  // wider registers, big endian
+    uint8_t pointer = 0;
+    uint64_t conv_start = 0; // conversion cycles count from here
+
+    void refresh();
+    void reset();
+};
+
+/// @brief TCA9548A switch, devices behind it are reachable while their channel is on
+class sim_tca9548a : public sim_device
+{
+public:
+    uint8_t control = 0;
+
+    sim_tca9548a(uint8_t addr);
+    int write(const uint8_t *buf, uint16_t len) override;
+    int read(uint8_t *buf, uint16_t len) override;
+};
+
+/// @brief ALERT lines of simulated devices. wait() sleeps on clk() up to
+/// the earliest edge, so event driven acquisition runs in virtual time.
+class sim_events : public event_source
+{
+public:
+    /// @brief Connect a device ALERT pin to a line
+    void add(uint32_t line, sim_device *dev);
+
+    int wait(line_event *ev, int max, uint64_t timeout_us) override;
+
+private:
+    std::vector<std::pair<uint32_t, sim_device *>> lines;
+};
+
+/// @brief Bus backend dispatching to simulated devices.
+/// With a virtual clock the transfer time at bitrate is added to the clock.
+class sim_bus : public i2c_backend
+{
+public:
+    uint32_t bitrate = 400000;        // [bit/s], 0 = transfers take no time
+    virtual_clock *vclock = nullptr;  // Clock to charge transfer time to
+
+    // Statistics
+    uint64_t transactions = 0;
+    uint64_t bus_time_us = 0;
+
+    sim_bus(/* args */);
+    ~sim_bus();
+
+    /// @brief Add device, the bus owns it
+    void add(sim_device *dev);
+
+    /// @brief Add device behind a mux channel, the bus owns it
+    void add(sim_device *dev, sim_tca9548a *mux, uint8_t channel);
+
+    // Statistics
+    uint64_t collisions = 0; // transfers answered by more than one device
+
+    int transfer(struct i2c_msg *msgs, uint32_t nmsgs) override;
+
+private:
+    bool visible(const sim_device *dev) const;
+
+    std::vector<sim_device *> devices;
+    double bit_time = 0; // carry of sub-microsecond transfer time
+};
+
+#endif /* SIM_BUS_H_ */
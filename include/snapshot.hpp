@@ -0,0 +1,115 @@
+/*
+ * File:     snapshot.hpp
+ * Notes:    Coherent multi-device snapshots by synchronized triggering
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "i_i2c.hpp"
+#include "sht3x.hpp"
+#include "ms5607.hpp"
+#include "pac193x.hpp"
+#include "sample.hpp"
+
+#define SNAPSHOT_MEMBERS 8  // devices per snapshot
+#define SNAPSHOT_SAMPLES 32 // samples per frame
+#define REFRESH_G        0x1E // PAC193x REFRESH as general call
+
+/// @brief Time aligned samples of one snapshot
+struct snapshot_frame
+{
+    uint64_t timestamp;  // [us] since epoch, middle of the trigger transaction
+    uint32_t skew_us;    // all triggers were issued within this bound
+    uint32_t latency_us; // trigger to last result
+    uint8_t count;       // valid samples
+    sample samples[SNAPSHOT_SAMPLES];
+};
+
+/// @brief Triggers all members back to back in one combined I2C
+/// transaction (repeated start, one stop), then collects each result as
+/// soon as it is ready. Every sample of a frame carries the same
+/// timestamp, the measured duration of the trigger transaction bounds
+/// the skew between the devices.
+///
+/// Triggers: SHT3x single shot, MS5607 D1 conversion, PAC193x REFRESH_G
+/// as general call (one message for all PACs, or REFRESH per device when
+/// general_call is false). The MS5607 D2 conversion needed for
+/// compensation runs after D1 and is not coherent, temperature is
+/// assumed to change slowly.
+///
+/// The combined transaction is sent through one interface, so all
+/// members must be on the same bus segment. SHT3x members must not be in
+/// periodic mode. REFRESH_G also resets the accumulators of PACs outside
+/// the snapshot.
+class snapshot
+{
+    enum class Type : uint8_t
+    {
+        SHT3X,
+        MS5607,
+        PAC193X
+    };
+
+    struct member
+    {
+        Type type;
+        union
+        {
+            sht3x *sht;
+            ms5607 *ms;
+            pac193x_base *pac;
+        };
+        i_i2c *i2c;
+        bool enabled;
+        int status;        // result of the last take(), <0 on failure
+        uint64_t deadline; // result ready [us], monotonic
+    };
+
+public:
+    i_i2c *bus = nullptr;        // Trigger interface, first member's if not set
+    bool general_call = true;    // PAC193x REFRESH_G instead of REFRESH per device
+    Repeatability rept = Repeatability::HIGH; // SHT3x single shot repeatability
+
+    // Statistics
+    uint32_t taken = 0;       // Frames
+    uint32_t skew_max_us = 0; // Worst skew bound
+
+    snapshot(/* args */);
+    ~snapshot();
+
+    /// @brief Add device, PAC193x of any variant with all its channels
+    /// @param dev Device
+    /// @return Member index, <0 if full
+    int add(sht3x *dev);
+    int add(ms5607 *dev);
+    int add(pac193x_base *dev);
+
+    /// @brief Include or skip a member, e.g. while it is recovering
+    void enable(int n, bool on);
+
+    /// @brief Result of member n in the last take()
+    /// @return Action status, <0 on failure
+    int status(int n) const;
+
+    /// @brief Trigger all enabled members and collect their results
+    /// @param frame Destination
+    /// @return Number of samples, <0 if the trigger transaction failed
+    int take(snapshot_frame &frame);
+
+private:
+    member members[SNAPSHOT_MEMBERS];
+    int nmembers = 0;
+
+    member *add(Type type, i_i2c *i2c);
+    int trigger(uint64_t &before, uint64_t &after);
+    int collect(member &m, snapshot_frame &frame);
+};
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,130 @@
+/*
+ * File:     store.hpp
+ * Notes:    Append-only memory mapped columnar sample store
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef STORE_H_
+#define STORE_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "sample.hpp"
+
+#define SEGMENT_MAGIC   0x31474553 // "SEG1"
+#define SEGMENT_VERSION 1
+#define SEGMENT_SIZE    (256 * 1024) // default segment file size
+
+/// @brief On-disk segment header, the file is mapped and used in place.
+/// A segment holds one channel in two columns: timestamps as zigzag
+/// varint delta-of-delta, values as zigzag varint delta. A steady
+/// sampling period and a slowly moving 16/24 bit code take 2-4 bytes
+/// per sample. When a segment is sealed a copy with the value column
+/// next to the timestamp column replaces the file, readers of the full
+/// size file keep their mapping.
+struct segment_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sealed;      // 1 when no more appends
+    uint32_t channel;
+    uint32_t count;       // samples, written last on append
+    uint64_t first_ts;    // [us]
+    uint64_t last_ts;     // [us]
+    int64_t last_delta;   // last timestamp delta, for delta-of-delta
+    int32_t last_value;
+    uint32_t ts_offset;   // timestamp column start
+    uint32_t ts_bytes;    // timestamp column used bytes
+    uint32_t value_offset;// value column start
+    uint32_t value_bytes; // value column used bytes
+    uint32_t column_size; // column capacity
+    uint8_t reserved[64];
+};
+
+/// @brief Append-only writer, one open segment per channel
+class sample_store
+{
+    struct segment
+    {
+        int fd;
+        uint32_t seq;       // sequence number within the channel
+        size_t size;        // mapped size
+        segment_header *hdr;
+        uint8_t *base;
+    };
+
+public:
+    std::string dir;                  // Store directory
+    uint32_t segment_size = SEGMENT_SIZE;
+    uint32_t retention = 0;           // Segments kept per channel, 0 = unlimited
+
+    sample_store(/* args */);
+    ~sample_store();
+
+    /// @brief Append sample
+    /// @param s Sample, timestamps per channel must not go back
+    /// @return Action status, <0 on failure
+    int append(const sample &s);
+
+    /// @brief Append samples
+    /// @param s Samples
+    /// @param n Number of samples
+    /// @return Number of samples appended
+    size_t append(const sample *s, size_t n);
+
+    /// @brief Flush mapped pages to storage
+    /// @return Action status
+    int flush();
+
+    /// @brief Seal and unmap all open segments
+    void close();
+
+private:
+    std::unordered_map<uint32_t, segment> open_segs;
+
+    segment *get(uint32_t channel, uint64_t ts);
+    int open_segment(segment &seg, uint32_t channel, uint32_t seq, bool create);
+    void seal(segment &seg);
+    void repair(segment &seg);
+    void expire(uint32_t channel, uint32_t newest);
+};
+
+/// @brief Range scan over a store directory.
+/// Segments are mapped read-only, segments outside the requested range
+/// are skipped by their header, the rest is decoded in a tight loop.
+class store_reader
+{
+public:
+    std::string dir; // Store directory
+
+    store_reader(/* args */);
+    ~store_reader();
+
+    /// @brief List channels present in the store
+    /// @return Channel ids
+    std::vector<uint32_t> channels();
+
+    /// @brief Read samples of one channel in [from, to]
+    /// @param channel Channel id
+    /// @param from First timestamp [us]
+    /// @param to Last timestamp [us]
+    /// @param ts Timestamps appended here
+    /// @param values Values appended here
+    /// @return Number of samples read
+    size_t scan(uint32_t channel, uint64_t from, uint64_t to,
+                std::vector<uint64_t> &ts, std::vector<int32_t> &values);
+};
+
+/// @brief Segment file name for channel and sequence number
+std::string segment_name(uint32_t channel, uint32_t seq);
+
+/// @brief Sequence numbers of segments of a channel, ascending
+std::vector<uint32_t> segment_list(const std::string &dir, uint32_t channel);
+
+#endif /* STORE_H_ */
@@ -0,0 +1,236 @@
+/*
+ * File:     sysfs.hpp
+ * Notes:    Devices owned by kernel drivers, read through hwmon and IIO sysfs
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef SYSFS_H_
+#define SYSFS_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include "sample.hpp"
+
+#define SYSFS_PATH_MAX   256
+#define IIO_CHANNELS_MAX 8   // channels per IIO device
+#define IIO_RECORDS      16  // buffer records read at once
+
+/// @brief Attribute opened once and read with pread() at offset 0,
+/// which makes sysfs format a fresh value without reopening the file
+class sysfs_attr
+{
+public:
+    sysfs_attr(/* args */);
+    ~sysfs_attr();
+
+    /// @brief Open attribute
+    /// @param dir Device directory
+    /// @param attr Attribute name
+    /// @return Action status, <0 on failure
+    int Open(const char *dir, const char *attr);
+    void Close();
+    bool is_open() const { return fd >= 0; }
+
+    /// @brief Read integer attribute, e.g. hwmon millidegrees
+    /// @return Action status, <0 on failure
+    int read(long long &value);
+
+    /// @brief Read decimal attribute, e.g. IIO "101.325000"
+    /// @return Action status, <0 on failure
+    int read(double &value);
+
+    /// @brief Read text attribute without the trailing newline
+    /// @return Action status, <0 on failure
+    int read(char *buf, size_t size);
+
+private:
+    int fd = -1;
+};
+
+/// @brief Find a device by its name attribute
+/// @param dir Class or bus directory, e.g. <root>/class/hwmon
+/// @param name Expected content of <device>/name
+/// @param path Device directory found
+/// @param size Size of path
+/// @return Action status, <0 if not found
+int sysfs_find(const char *dir, const char *name, char *path, size_t size);
+
+/// @brief Write attribute, for setup only
+/// @return Action status, <0 on failure
+int sysfs_write(const char *dir, const char *attr, const char *value);
+
+/// @brief SHT3x owned by the kernel hwmon driver. Temperature and
+/// humidity are converted back to device codes, so the samples match
+/// those of the I2C driver.
+class hwmon_sht3x
+{
+public:
+    const char *root = "/sys";  // sysfs mount, a fake tree for tests
+    const char *name = "sht3x"; // hwmon name
+    uint16_t node = 0x44;       // Node of the samples, as i_i2c::node()
+
+    hwmon_sht3x(/* args */);
+    ~hwmon_sht3x();
+
+    /// @brief Find the hwmon device and open its attributes
+    /// @return Action status, <0 on failure
+    int Open();
+    void Close();
+
+    /// @brief Read temperature and humidity
+    /// @param out SHT3X_T and SHT3X_RH samples
+    /// @param max Capacity of out
+    /// @return Number of samples, 0 on failure
+    size_t read(sample *out, size_t max);
+
+    /// @brief Read in physical units, like sht3x::get_results()
+    /// @return Action status, <0 on failure
+    int get_results(float *temperature, float *humidity);
+
+private:
+    sysfs_attr temp;     // temp1_input [m°C]
+    sysfs_attr humidity; // humidity1_input [m%]
+};
+
+/// @brief IIO buffer: scan elements of a device streamed through its
+/// character device. Records are laid out by scan index, every element
+/// aligned to its storage size, as the IIO ABI specifies.
+class iio_buffer
+{
+public:
+    bool timestamp = false; // Records carry in_timestamp, set by Open()
+
+    iio_buffer(/* args */);
+    ~iio_buffer();
+
+    /// @brief Enable scan elements and start the buffer
+    /// @param dir IIO device directory
+    /// @param devnode Character device
+    /// @param names Scan element names without in_ and _en, e.g. "temp"
+    /// @param n Number of names
+    /// @param length Kernel buffer length [records]
+    /// @param trigger Trigger to select, empty to keep the current one
+    /// @return Action status, <0 if the device has no buffer
+    int Open(const char *dir, const char *devnode, const char *const *names, int n,
+             uint32_t length, const char *trigger);
+    void Close();
+    bool active() const { return fd >= 0; }
+
+    /// @brief Read the records that are ready, without blocking
+    /// @param values Raw values, n per record in the order of names
+    /// @param ts Timestamps [ns], if timestamp is set
+    /// @param max Capacity [records]
+    /// @return Number of records, <0 on failure
+    int read(int64_t *values, int64_t *ts, int max);
+
+private:
+    struct element
+    {
+        uint32_t offset; // in the record
+        uint8_t bytes;   // storage
+        uint8_t bits;    // valid bits
+        uint8_t shift;
+        bool is_signed;
+        bool be;
+    };
+
+    char dir[SYSFS_PATH_MAX];
+    element elements[IIO_CHANNELS_MAX + 1]; // last is the timestamp
+    int nelements = 0;
+    uint32_t record_size = 0;
+    int fd = -1;
+    uint8_t records[IIO_RECORDS * 8 * (IIO_CHANNELS_MAX + 1)];
+
+    int parse(const char *name, element &e, int &index);
+    int64_t extract(const uint8_t *record, const element &e) const;
+};
+
+/// @brief IIO device read through sysfs attributes, or through its
+/// buffer if it has one. Values are converted to sample codes.
+class iio_device
+{
+public:
+    const char *root = "/sys";    // sysfs mount, a fake tree for tests
+    const char *dev_root = "/dev"; // character devices
+    const char *name = "";        // IIO name
+    const char *trigger = "";     // Buffer trigger, empty to keep the current one
+    bool buffered = true;         // Use the buffer if the driver has one
+    uint32_t buffer_length = 64;  // [records]
+    uint16_t node = 0;            // Node of the samples, as i_i2c::node()
+
+    virtual ~iio_device();
+
+    /// @brief Find the device, open attributes, start the buffer
+    /// @return Action status, <0 on failure
+    int Open();
+    void Close();
+
+    /// @brief True if readings come from the buffer
+    bool streaming() const { return buffer.active(); }
+
+    /// @brief Read channels. From the buffer every record that is ready,
+    /// otherwise one reading of the attributes.
+    /// @param out Samples
+    /// @param max Capacity of out
+    /// @return Number of samples
+    size_t read(sample *out, size_t max);
+
+protected:
+    struct channel
+    {
+        char attr[32];   // Attribute without the in_ prefix, e.g. "temp_input"
+        char scan[24];   // Scan element, e.g. "temp"
+        Kind kind;
+        uint8_t index;
+        bool raw;        // Attribute and scan element are device codes
+        double to_code;  // Sample code per unit of attr
+    };
+
+    channel channels[IIO_CHANNELS_MAX];
+    int nchannels = 0;
+    int32_t last[IIO_CHANNELS_MAX] = {}; // Latest codes
+    double scale[IIO_CHANNELS_MAX];      // in_<scan>_scale, 1 if absent
+    double offset[IIO_CHANNELS_MAX];     // in_<scan>_offset, 0 if absent
+
+    void add(const char *attr, const char *scan, Kind kind, uint8_t index, bool raw, double to_code);
+
+private:
+    sysfs_attr attrs[IIO_CHANNELS_MAX];
+    iio_buffer buffer;
+
+    int32_t code(int i, double value) const;
+};
+
+/// @brief MS5607 owned by the kernel ms5611 IIO driver. The driver
+/// compensates, samples are BARO_T and BARO_P instead of D1 and D2.
+class iio_ms5607 : public iio_device
+{
+public:
+    iio_ms5607(/* args */);
+
+    float get_temperature() const { return last[0] * 0.01f; } // [°C]
+    float get_pressure() const { return last[1] * 0.01f; }    // [mbar]
+    float get_altitude() const;                               // [m]
+};
+
+/// @brief PAC193x owned by the kernel pac1934 IIO driver. Raw codes are
+/// read, samples are PAC_VBUS and PAC_VSENSE like with the I2C driver.
+class iio_pac193x : public iio_device
+{
+public:
+    /// @param channels Channels of the variant
+    /// @param mean Averaged registers
+    iio_pac193x(uint8_t channels = 3, bool mean = true);
+
+    float get_bus_voltage(uint8_t ch) const;   // [V]
+    float get_current(uint8_t ch) const;       // [mA]
+
+private:
+    uint8_t nch;
+};
+
+#endif /* SYSFS_H_ */
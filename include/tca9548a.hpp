@@ -0,0 +1,92 @@
+/*
+ * File:     tca9548a.hpp
+ * Notes:    TCA9548A style I2C multiplexer and mux aware job scheduling
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef TCA9548A_H_
+#define TCA9548A_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <functional>
+#include <vector>
+#include "i_i2c.hpp"
+
+#define MUX_ADDR     0x70 // A2..A0 to GND, up to 0x77
+#define MUX_CHANNELS 8
+#define MUX_UNKNOWN  0xFF // selection not known, next select always writes
+
+/// @brief 8 channel I2C switch.
+/// The selected channel is cached, a select of the channel already
+/// selected costs nothing. Devices behind the mux set i_i2c::mux and
+/// i_i2c::mux_channel, i_i2c::Transfer() selects before every transaction.
+/// Muxes on the same bus (i_i2c::device) know each other, a select
+/// disconnects the channel of the mux selected before, so identical
+/// devices behind two muxes never answer together.
+class tca9548a
+{
+public:
+    i_i2c *i2c; // Upstream interface, address is the mux address
+
+    // Statistics
+    uint64_t selects = 0; // control register writes
+    uint64_t skipped = 0; // selects served from cache
+
+    tca9548a(/* args */);
+    ~tca9548a();
+
+    /// @brief Route the bus to one channel
+    /// @param channel 0..7
+    /// @return Action status, <0 on failure
+    int select(uint8_t channel);
+
+    /// @brief Disconnect all channels
+    /// @return Action status
+    int deselect();
+
+    /// @brief Forget the cached selection, e.g. after a bus fault
+    void invalidate() { current = MUX_UNKNOWN; }
+
+    /// @brief Selected channel or MUX_UNKNOWN
+    uint8_t selected() const { return current; }
+
+private:
+    uint8_t current = MUX_UNKNOWN;
+    uint8_t control = 0;
+
+    int write_control(uint8_t value);
+    int release_others();
+};
+
+/// @brief Runs queued bus jobs grouped by mux channel.
+/// Jobs are reordered so each mux channel is selected at most once per
+/// run, channels already selected go first. Order within a channel is kept.
+class mux_scheduler
+{
+    struct job
+    {
+        i_i2c *dev;
+        std::function<void()> work;
+    };
+
+public:
+    /// @brief Queue a job which uses dev
+    void add(i_i2c *dev, std::function<void()> work);
+
+    /// @brief Run and clear all queued jobs
+    /// @return Number of jobs run
+    size_t run();
+
+    /// @brief Number of queued jobs
+    size_t size() const { return jobs.size(); }
+
+private:
+    std::vector<job> jobs;
+    std::vector<size_t> order;
+};
+
+#endif /* TCA9548A_H_ */
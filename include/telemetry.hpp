@@ -0,0 +1,167 @@
+/*
+ * File:     telemetry.hpp
+ * Notes:    Binary sample stream over a Unix domain socket, publisher and client
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "sample.hpp"
+
+#define TELEMETRY_MAGIC       0x314D4C54 // "TLM1"
+#define TELEMETRY_SUB_MAGIC   0x31425553 // "SUB1"
+#define TELEMETRY_VERSION     1
+#define TELEMETRY_PATH        "/run/sht3x.sock"
+#define TELEMETRY_SUBSCRIBERS 8
+#define TELEMETRY_FILTERS     8    // channel filters per subscriber
+#define TELEMETRY_QUEUE       4096 // samples buffered per subscriber, power of two
+#define TELEMETRY_FRAME       256  // samples per frame
+#define TELEMETRY_MMSG        16   // frames per sendmmsg()
+
+/// @brief Frame header, followed by count samples of 16 bytes each.
+/// Host byte order, both ends run on the same machine.
+struct telemetry_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;   // samples in this frame
+    uint32_t seq;     // frame counter of the subscriber
+    uint32_t dropped; // samples dropped for this subscriber so far
+};
+
+/// @brief Channel filter, a sample passes if (channel & mask) == value
+/// for any filter, e.g. mask 0xFFFF0000 selects one node and mask
+/// 0x0000FF00 one Kind
+struct telemetry_filter
+{
+    uint32_t mask;
+    uint32_t value;
+};
+
+/// @brief Subscribe message, sent by the client after connecting and
+/// again to change the filters. No filters selects all channels.
+struct telemetry_subscribe
+{
+    uint32_t magic;
+    uint32_t count;
+    telemetry_filter filters[TELEMETRY_FILTERS];
+};
+
+static_assert(sizeof(sample) == 16, "sample is the wire record");
+static_assert(sizeof(telemetry_header) == 16, "header is part of the wire format");
+
+/// @brief Acquisition side: streams samples to subscribers over a
+/// SOCK_SEQPACKET socket, one frame per message.
+///
+/// publish() only copies the samples a subscriber selected into its
+/// queue. flush() sends the queues as frames, up to TELEMETRY_MMSG
+/// frames in one sendmmsg() per subscriber, the frames point into the
+/// queue so nothing is copied again. Nothing ever blocks: when a
+/// subscriber doesn't keep up its socket fills, the queue is kept for
+/// the next flush() and when the queue is full the oldest samples are
+/// dropped and counted in the frame header.
+class telemetry_publisher
+{
+public:
+    std::string path = TELEMETRY_PATH; // Socket path
+    uint32_t queue = TELEMETRY_QUEUE;  // Samples per subscriber, power of two
+    uint16_t frame = TELEMETRY_FRAME;  // Samples per frame
+
+    // Statistics
+    uint64_t frames = 0;  // Frames sent
+    uint64_t sent = 0;    // Samples sent
+    uint64_t dropped = 0; // Samples dropped, all subscribers
+
+    telemetry_publisher(/* args */);
+    ~telemetry_publisher();
+
+    /// @brief Create and bind the socket
+    /// @return Action status, <0 on failure
+    int Open();
+
+    /// @brief Disconnect all subscribers and remove the socket
+    void Close();
+
+    /// @brief Accept new subscribers, take filter changes and queue
+    /// samples for every subscriber that selected them
+    /// @param s Samples
+    /// @param n Number of samples
+    void publish(const sample *s, size_t n);
+
+    /// @brief Send queued samples, as much as the sockets take
+    /// @return Number of samples sent
+    size_t flush();
+
+    size_t subscribers() const { return subs.size(); }
+
+private:
+    struct subscriber
+    {
+        int fd;
+        bool subscribed;              // subscribe message received
+        uint32_t nfilters;
+        telemetry_filter filters[TELEMETRY_FILTERS];
+        std::vector<sample> ring;
+        uint64_t head, tail;          // free running, head - tail queued
+        uint32_t seq;
+        uint32_t dropped;
+    };
+
+    int fd = -1;
+    std::vector<subscriber> subs;
+
+    void accept_all();
+    bool receive(subscriber &sub);
+    bool selected(const subscriber &sub, uint32_t channel) const;
+    int send(subscriber &sub);
+    void drop(size_t i);
+};
+
+/// @brief Subscriber side, used by downstream tools
+class telemetry_client
+{
+public:
+    std::string path = TELEMETRY_PATH; // Socket path
+
+    // Statistics
+    uint32_t lost = 0;    // Frames missing from the sequence
+    uint32_t dropped = 0; // Samples dropped by the publisher, latest header
+
+    telemetry_client(/* args */);
+    ~telemetry_client();
+
+    /// @brief Connect and subscribe
+    /// @param filters Channel filters, nullptr for all channels
+    /// @param n Number of filters
+    /// @return Action status, <0 on failure
+    int Open(const telemetry_filter *filters = nullptr, uint32_t n = 0);
+    void Close();
+
+    /// @brief Change the channel filters
+    /// @return Action status, <0 on failure
+    int subscribe(const telemetry_filter *filters, uint32_t n);
+
+    /// @brief Receive one frame, blocking
+    /// @param out Samples
+    /// @param max Capacity of out, at least the frame size of the publisher
+    /// @return Number of samples, <0 on failure or when the publisher is gone
+    int read(sample *out, size_t max);
+
+    /// @brief Socket to poll for readiness
+    int handle() const { return fd; }
+
+private:
+    int fd = -1;
+    uint32_t next_seq = 0;
+};
+
+#endif /* TELEMETRY_H_ */
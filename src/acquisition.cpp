@@ -0,0 +1,533 @@
+/*
+ * File:     acquisition.cpp
+ * Notes:    Configuration driven device set for daemon mode, reloaded in place
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "acquisition.hpp"
+#include "sht3x.hpp"
+#include "ms5607.hpp"
+#include "pac193x.hpp"
+#include <stdlib.h>
+#include <stdio.h>
+
+
+int device_configs(const std::vector<config_section> &sections, std::vector<device_config> &out)
+{
+    out.clear();
+    for (auto &s : sections)
+    {
+        device_config c;
+        long long address = -1, period_ms = ACQ_PERIOD_US / 1000, mux = 0, channel = 0;
+
+        c.alias = s.name;
+        c.type = s.get("type", "");
+        c.bus = s.get("bus", "");
+        if (s.get("address", address) < 0 || address < 0x03 || address > 0x77 ||
+            s.get("period_ms", period_ms) < 0 || period_ms <= 0 || c.bus.empty())
+        {
+            printf("CONFIG: ERROR - [%s] needs bus, address and a positive period_ms\n", s.name.c_str());
+            return -1;
+        }
+        if (s.get("mux", mux) < 0 || s.get("channel", channel) < 0 || (mux && (mux < MUX_ADDR || mux > 0x77)) ||
+            channel < 0 || channel >= MUX_CHANNELS)
+        {
+            printf("CONFIG: ERROR - [%s] mux needs an address 0x70..0x77 and a channel 0..7\n", s.name.c_str());
+            return -1;
+        }
+        c.address = address;
+        c.mux = mux;
+        c.mux_channel = channel;
+        c.period_us = period_ms * 1000;
+
+        if (c.type == "sht3x")
+            c.option = s.get("repeatability", "");
+        else if (c.type == "ms5607")
+            c.option = s.get("osr", "");
+        else if (c.type == "pac193x")
+            c.option = s.get("sample_rate", "");
+        out.push_back(c);
+    }
+    return 0;
+}
+
+acq_device::~acq_device()
+{
+}
+
+/// @brief Device read through the sensor contract of its driver
+template <typename S>
+class acq_sensor : public acq_device
+{
+    static_assert(S::SENSOR_SAMPLES <= ACQ_DEVICE_SAMPLES, "room for one read");
+
+public:
+    int poll(uint64_t now, uint64_t ts, sample *out, size_t max) override
+    {
+        uint32_t errors = sched.errors[0];
+        size_t n = sched.poll(now, ts, out, max);
+        if (sched.errors[0] != errors)
+        {
+            printf("%s: Read error %s\n", cfg.alias.c_str(), status_name(sched.last[0]));
+            return -1;
+        }
+        return n;
+    }
+
+    uint64_t deadline() const override { return sched.next_deadline(); }
+
+    void restart(uint64_t at) override
+    {
+        sched.period_us[0] = cfg.period_us;
+        sched.restart(at);
+    }
+
+protected:
+    S snsr;
+    sensor_scheduler<S> sched{&snsr};
+};
+
+/// @brief SHT3x in periodic mode, the slowest rate that keeps up with the period
+class acq_sht3x : public acq_sensor<sht3x>
+{
+public:
+    acq_sht3x()
+    {
+        snsr.i2c = &i2c;
+        rec.settle_us = RESET_DURATION_US;
+    }
+
+    int check(const device_config &c) const override
+    {
+        Frequency f;
+        Repeatability r;
+        return parse(c, f, r);
+    }
+
+    int configure(const device_config &c) override
+    {
+        Frequency f;
+        Repeatability r;
+        if (parse(c, f, r) < 0)
+            return -1;
+        cfg.period_us = c.period_us;
+        cfg.option = c.option;
+        if (f == frq && r == rpt)
+            return 0;
+        frq = f;
+        rpt = r;
+        if (not rec.available())
+            return 0; // probe() starts with the new mode
+        snsr.stop();
+        return snsr.start(frq, rpt);
+    }
+
+    void shutdown() override
+    {
+        if (rec.available())
+            snsr.stop();
+    }
+
+protected:
+    int reset() override { return snsr.soft_reset(); }
+
+    int probe() override
+    {
+        if (snsr.get_status() < 0)
+            return -1;
+        return snsr.start(frq, rpt);
+    }
+
+private:
+    Frequency frq = Frequency::PERIODIC_1;
+    Repeatability rpt = Repeatability::HIGH;
+
+    static int parse(const device_config &c, Frequency &f, Repeatability &r)
+    {
+        if (c.option.empty() || c.option == "high")
+            r = Repeatability::HIGH;
+        else if (c.option == "medium")
+            r = Repeatability::MEDIUM;
+        else if (c.option == "low")
+            r = Repeatability::LOW;
+        else
+            return -1;
+
+        // 10 mps is the fastest periodic mode, reading faster only gets NACKs
+        if (c.period_us < 100000)
+            return -1;
+        f = c.period_us >= 2000000 ? Frequency::PERIODIC_05 : c.period_us >= 1000000 ? Frequency::PERIODIC_1
+          : c.period_us >= 500000 ? Frequency::PERIODIC_2 : c.period_us >= 250000 ? Frequency::PERIODIC_4
+          : Frequency::PERIODIC_10;
+        return 0;
+    }
+};
+
+/// @brief MS5607 converted on every read, option is the OSR
+class acq_ms5607 : public acq_sensor<ms5607>
+{
+public:
+    acq_ms5607()
+    {
+        snsr.i2c = &i2c;
+        rec.settle_us = RESET_DELAY_US;
+    }
+
+    int check(const device_config &c) const override
+    {
+        uint16_t osr;
+        return parse(c, osr);
+    }
+
+    int configure(const device_config &c) override
+    {
+        uint16_t osr;
+        if (parse(c, osr) < 0)
+            return -1;
+        cfg.period_us = c.period_us;
+        cfg.option = c.option;
+        snsr.setOSR(osr); // Takes effect on the next conversion, no bus access
+        return 0;
+    }
+
+protected:
+    int reset() override { return snsr.soft_reset() ? 0 : -1; }
+    int probe() override { return snsr.calibration() ? 0 : -1; }
+
+private:
+    static int parse(const device_config &c, uint16_t &osr)
+    {
+        osr = c.option.empty() ? 4096 : atoi(c.option.c_str());
+        return osr == 256 || osr == 512 || osr == 1024 || osr == 2048 || osr == 4096 ? 0 : -1;
+    }
+};
+
+/// @brief PAC193x averaged registers, refreshed before every read
+class acq_pac193x : public acq_sensor<pac193x>
+{
+public:
+    acq_pac193x()
+    {
+        snsr.i2c = &i2c;
+        rec.settle_us = REFRESH_DELAY_US;
+    }
+
+    int check(const device_config &c) const override
+    {
+        pac193x_base::SampleRate r;
+        return parse(c, r);
+    }
+
+    int configure(const device_config &c) override
+    {
+        pac193x_base::SampleRate r;
+        if (parse(c, r) < 0)
+            return -1;
+        cfg.period_us = c.period_us;
+        cfg.option = c.option;
+        if (r == rate)
+            return 0;
+        rate = r;
+        if (not rec.available())
+            return 0;
+        return snsr.set_sample_rate(rate) ? 0 : -1;
+    }
+
+protected:
+    int reset() override { return snsr.refresh() ? 0 : -1; }
+    int probe() override { return snsr.init() && snsr.set_sample_rate(rate) ? 0 : -1; }
+
+private:
+    pac193x_base::SampleRate rate = pac193x_base::SampleRate::SPS_1024;
+
+    static int parse(const device_config &c, pac193x_base::SampleRate &r)
+    {
+        int sps = c.option.empty() ? 1024 : atoi(c.option.c_str());
+        switch (sps)
+        {
+        case 1024:
+            r = pac193x_base::SampleRate::SPS_1024;
+            return 0;
+        case 256:
+            r = pac193x_base::SampleRate::SPS_256;
+            return 0;
+        case 64:
+            r = pac193x_base::SampleRate::SPS_64;
+            return 0;
+        case 8:
+            r = pac193x_base::SampleRate::SPS_8;
+            return 0;
+        }
+        return -1;
+    }
+};
+
+acquisition::acquisition(/* args */)
+{
+}
+
+acquisition::~acquisition()
+{
+    while (not devices.empty())
+        remove(devices.size() - 1);
+}
+
+tca9548a *acquisition::get_mux(const device_config &c)
+{
+    for (auto m : muxes)
+    {
+        if (m->bus == c.bus && m->i2c.address == c.mux)
+        {
+            m->users++;
+            return &m->mux;
+        }
+    }
+
+    acq_mux *m = new acq_mux;
+    m->bus = c.bus;
+    m->i2c.alias = "TCA9548A";
+    m->i2c.device = m->bus.c_str();
+    m->i2c.address = c.mux;
+    if (attach)
+        attach(m->i2c);
+    if (m->i2c.Open() < 0)
+    {
+        if (detach)
+            detach(m->i2c);
+        delete m;
+        return nullptr;
+    }
+    m->mux.i2c = &m->i2c;
+    m->users = 1;
+    muxes.push_back(m);
+    return &m->mux;
+}
+
+void acquisition::put_mux(tca9548a *mux)
+{
+    for (size_t i = 0; i < muxes.size(); i++)
+    {
+        acq_mux *m = muxes[i];
+        if (&m->mux != mux || --m->users > 0)
+            continue;
+        // Nothing left behind it, leave every channel off
+        m->mux.deselect();
+        if (detach)
+            detach(m->i2c);
+        m->i2c.Close();
+        delete m;
+        muxes.erase(muxes.begin() + i);
+        return;
+    }
+}
+
+acq_device *acquisition::make(const std::string &type)
+{
+    if (type == "sht3x")
+        return new acq_sht3x();
+    if (type == "ms5607")
+        return new acq_ms5607();
+    if (type == "pac193x")
+        return new acq_pac193x();
+    return nullptr;
+}
+
+int acquisition::load(const char *path, uint64_t now)
+{
+    std::vector<config_section> sections;
+    std::vector<device_config> cfgs;
+
+    if (config_load(path, sections) < 0 || device_configs(sections, cfgs) < 0)
+    {
+        printf("ACQ: %s rejected, %zu devices unchanged\n", path, devices.size());
+        return -1;
+    }
+    return apply(cfgs, now);
+}
+
+int acquisition::apply(const std::vector<device_config> &cfgs, uint64_t now)
+{
+    // Validate the whole set first, an invalid set changes nothing
+    for (size_t i = 0; i < cfgs.size(); i++)
+    {
+        const device_config &c = cfgs[i];
+        for (size_t k = 0; k < i; k++)
+        {
+            if (cfgs[k].alias == c.alias || (cfgs[k].same_segment(c) && cfgs[k].address == c.address))
+            {
+                printf("ACQ: ERROR - [%s] duplicates [%s]\n", c.alias.c_str(), cfgs[k].alias.c_str());
+                return -1;
+            }
+        }
+        acq_device *d = make(c.type);
+        int ret = d ? d->check(c) : -1;
+        delete d;
+        if (ret < 0)
+        {
+            printf("ACQ: ERROR - [%s] invalid type or setting\n", c.alias.c_str());
+            return -1;
+        }
+    }
+
+    // Removed first, so a replacement can take over the address
+    for (size_t i = devices.size(); i-- > 0;)
+    {
+        size_t k = 0;
+        while (k < cfgs.size() && cfgs[k].alias != devices[i]->cfg.alias)
+            k++;
+        if (k == cfgs.size() || not cfgs[k].same_device(devices[i]->cfg))
+            remove(i);
+    }
+
+    for (auto &c : cfgs)
+    {
+        acq_device *d = nullptr;
+        for (auto dev : devices)
+            if (dev->cfg.alias == c.alias)
+                d = dev;
+
+        if (d == nullptr)
+        {
+            start(c, now);
+            continue;
+        }
+        // A reload retries devices that went offline
+        if (d->rec.get_state() == recovery::State::OFFLINE)
+            d->rec.rearm(now);
+        if (d->cfg == c)
+            continue;
+
+        printf("ACQ: %s period %llu -> %llu ms, option '%s' -> '%s'\n", c.alias.c_str(),
+               (unsigned long long)(d->cfg.period_us / 1000), (unsigned long long)(c.period_us / 1000),
+               d->cfg.option.c_str(), c.option.c_str());
+        if (d->configure(c) < 0)
+            d->rec.fault(now);
+        // First read one new period after the change, like after a start
+        d->restart(now + c.period_us);
+        changed++;
+    }
+    reloads++;
+    printf("ACQ: %zu devices, %u added, %u removed, %u changed so far\n", devices.size(), added, removed, changed);
+    return 0;
+}
+
+int acquisition::start(const device_config &c, uint64_t now)
+{
+    acq_device *d = make(c.type);
+    d->cfg = c;
+    d->i2c.alias = d->cfg.alias.c_str();
+    d->i2c.device = d->cfg.bus.c_str();
+    d->i2c.address = c.address;
+    if (c.mux)
+    {
+        d->i2c.mux = get_mux(c);
+        d->i2c.mux_channel = c.mux_channel;
+    }
+    if (attach)
+        attach(d->i2c);
+    if ((c.mux && d->i2c.mux == nullptr) || d->i2c.Open() < 0)
+    {
+        printf("ACQ: ERROR - %s not added\n", c.alias.c_str());
+        if (detach)
+            detach(d->i2c);
+        if (d->i2c.mux)
+            put_mux(d->i2c.mux);
+        delete d;
+        return -1;
+    }
+
+    d->rec.alias = d->cfg.alias.c_str();
+    d->rec.i2c = &d->i2c;
+    d->rec.soft_reset = [d]() { return d->reset(); };
+    d->rec.probe = [d]() { return d->probe(); };
+    // Brought up by the recovery machine, nothing here waits on the bus
+    d->rec.start(now);
+    d->configure(c);
+    devices.push_back(d);
+    added++;
+    if (c.mux)
+        printf("ACQ: %s added, %s at 0x%02x behind 0x%02x channel %u on %s every %llu ms\n", c.alias.c_str(),
+               c.type.c_str(), c.address, c.mux, c.mux_channel, c.bus.c_str(), (unsigned long long)(c.period_us / 1000));
+    else
+        printf("ACQ: %s added, %s at 0x%02x on %s every %llu ms\n", c.alias.c_str(), c.type.c_str(), c.address,
+               c.bus.c_str(), (unsigned long long)(c.period_us / 1000));
+    return 0;
+}
+
+void acquisition::remove(size_t i)
+{
+    acq_device *d = devices[i];
+    printf("ACQ: %s removed\n", d->cfg.alias.c_str());
+    d->shutdown();
+    if (detach)
+        detach(d->i2c);
+    d->i2c.Close();
+    if (d->i2c.mux)
+        put_mux(d->i2c.mux);
+    delete d;
+    devices.erase(devices.begin() + i);
+    removed++;
+}
+
+size_t acquisition::run(uint64_t now, uint64_t ts, sample *out, size_t max)
+{
+    // Two pointers, small enough for std::function to keep them inline
+    struct context
+    {
+        acquisition *acq;
+        uint64_t now, ts;
+        sample *out;
+        size_t max, count;
+    } ctx = {this, now, ts, out, max, 0};
+
+    for (auto d : devices)
+    {
+        bool online = d->rec.available();
+        d->rec.poll(now);
+        if (not d->rec.available())
+            continue;
+        // Started or recovered, periodic modes have the first result one period later
+        if (not online)
+            d->restart(now + d->cfg.period_us);
+        if (now < d->deadline())
+            continue;
+        reads.add(&d->i2c, [d, &ctx]() { ctx.acq->read(d, ctx.now, ctx.ts, ctx.out, ctx.max, ctx.count); });
+    }
+    // Devices behind the channel selected last go first
+    reads.run();
+    return ctx.count;
+}
+
+void acquisition::read(acq_device *d, uint64_t now, uint64_t ts, sample *out, size_t max, size_t &count)
+{
+    // Out of room, the device stays due for the next call
+    if (max - count < ACQ_DEVICE_SAMPLES)
+        return;
+
+    int n = d->poll(now, ts, out + count, max - count);
+    if (n < 0)
+        d->rec.fault(now);
+    else
+    {
+        d->rec.success();
+        count += n;
+    }
+}
+
+uint64_t acquisition::next_wakeup(uint64_t now) const
+{
+    uint64_t t = now + ACQ_PERIOD_US;
+
+    for (auto d : devices)
+    {
+        recovery::State s = d->rec.get_state();
+        if (s == recovery::State::ONLINE && d->deadline() < t)
+            t = d->deadline();
+        else if (s != recovery::State::ONLINE && s != recovery::State::OFFLINE && now + ACQ_RECOVERY_US < t)
+            t = now + ACQ_RECOVERY_US;
+    }
+    return t;
+}
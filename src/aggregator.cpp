@@ -0,0 +1,163 @@
+/*
+ * File:     aggregator.cpp
+ * Notes:    Streaming windowed aggregation of high rate channels
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "aggregator.hpp"
+#include <math.h>
+
+void window_stats::add(double x)
+{
+    if (count == 0)
+        min = max = x;
+    else if (x < min)
+        min = x;
+    else if (x > max)
+        max = x;
+
+    count++;
+    double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+}
+
+void window_stats::reset()
+{
+    count = 0;
+    min = max = mean = m2 = 0;
+}
+
+double window_stats::stddev() const
+{
+    return sqrt(variance());
+}
+
+rolling_window::rolling_window(uint32_t length)
+    : ring(length)
+{
+    minq.buf.resize(length);
+    maxq.buf.resize(length);
+}
+
+void rolling_window::add(double x)
+{
+    size_t len = ring.size();
+    uint64_t n = seq < len ? seq : len; // samples in window before add
+
+    if (seq >= len)
+    {
+        // Remove the oldest sample
+        double old = ring[seq % len];
+        if (n > 1)
+        {
+            double delta = old - mean;
+            mean -= delta / (n - 1);
+            m2 -= delta * (old - mean);
+        }
+        else
+            mean = m2 = 0;
+        n--;
+
+        if (minq.size && minq.front().seq + len <= seq)
+            minq.pop_front();
+        if (maxq.size && maxq.front().seq + len <= seq)
+            maxq.pop_front();
+    }
+
+    ring[seq % len] = x;
+    n++;
+    double delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+    if (m2 < 0) // rounding after removals
+        m2 = 0;
+
+    while (minq.size && minq.back().value >= x)
+        minq.pop_back();
+    minq.push_back({seq, x});
+    while (maxq.size && maxq.back().value <= x)
+        maxq.pop_back();
+    maxq.push_back({seq, x});
+    seq++;
+}
+
+window_stats rolling_window::stats() const
+{
+    window_stats st;
+    st.count = seq < ring.size() ? seq : ring.size();
+    if (st.count == 0)
+        return st;
+    st.mean = mean;
+    st.m2 = m2;
+    st.min = minq.buf[minq.head].value;
+    st.max = maxq.buf[maxq.head].value;
+    return st;
+}
+
+aggregator::aggregator(/* args */)
+{
+}
+
+aggregator::~aggregator()
+{
+    for (auto &it : channels)
+        delete it.second.rolling;
+}
+
+void aggregator::close(uint32_t channel, channel_state &st)
+{
+    if (emit && st.tumbling.count)
+    {
+        const window_stats &w = st.tumbling;
+        emit({channel, aggregate::TUMBLING, st.start, st.start + period_us,
+              w.count, w.min, w.max, w.mean, w.stddev()});
+    }
+    if (emit && st.rolling)
+    {
+        window_stats w = st.rolling->stats();
+        if (w.count)
+            emit({channel, aggregate::ROLLING, st.last, st.last,
+                  w.count, w.min, w.max, w.mean, w.stddev()});
+    }
+    st.tumbling.reset();
+}
+
+void aggregator::push(const sample &s)
+{
+    channel_state &st = channels[s.channel];
+
+    // Windows are aligned to the period so channels line up
+    uint64_t start = s.timestamp - s.timestamp % period_us;
+    if (st.tumbling.count == 0)
+        st.start = start;
+    else if (start != st.start)
+    {
+        close(s.channel, st);
+        st.start = start;
+    }
+
+    if (rolling_length && st.rolling == nullptr)
+        st.rolling = new rolling_window(rolling_length);
+
+    st.tumbling.add(s.value);
+    if (st.rolling)
+        st.rolling->add(s.value);
+    st.last = s.timestamp;
+}
+
+void aggregator::push(const sample *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        push(s[i]);
+}
+
+void aggregator::flush(uint64_t now)
+{
+    for (auto &it : channels)
+        if (it.second.tumbling.count && it.second.start + period_us <= now)
+            close(it.first, it.second);
+}
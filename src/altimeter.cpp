@@ -0,0 +1,228 @@
+/*
+ * File:     altimeter.cpp
+ * Notes:    Fixed point barometric altitude and vertical speed from MS5607 samples
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "altimeter.hpp"
+#include "clock.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+baro_altitude::baro_altitude(int32_t p0)
+{
+    set_reference(p0);
+}
+
+void baro_altitude::set_reference(int32_t p0)
+{
+    this->p0 = p0;
+    for (int i = 0; i < ALT_TABLE; i++)
+    {
+        double p = ALT_P_MIN + (i << ALT_P_SHIFT);
+        table[i] = (int32_t)lround(153.84615 * (pow(p0 / p, 0.19) - 1) * 1e6);
+    }
+}
+
+alpha_beta::alpha_beta(/* args */)
+{
+}
+
+void alpha_beta::reset()
+{
+    started = false;
+    gain_dt = 0;
+}
+
+void alpha_beta::gains(uint32_t dt)
+{
+    // Tracking index and the steady state gains of Kalata (1984)
+    double T = dt * 1e-6;
+    double lambda = accel_mm_s2 * T * T / noise_mm;
+    double r = (4 + lambda - sqrt(8 * lambda + lambda * lambda)) / 4;
+    alpha = 1 - r * r;
+    beta = 2 * (1 - r) * (1 - r);
+    ka = llround(alpha * 65536);
+    kb = llround(beta / T * 65536);
+    gain_dt = dt;
+}
+
+void alpha_beta::update(uint64_t t, int32_t z)
+{
+    if (not started || t > last + ALT_GAP_US)
+    {
+        h = (int64_t)z << 16;
+        v = 0;
+        last = t;
+        started = true;
+        return;
+    }
+    if (t <= last)
+        return;
+
+    uint32_t dt = t - last;
+    last = t;
+    if (dt > gain_dt + gain_dt / 16 || dt < gain_dt - gain_dt / 16)
+        gains(dt);
+
+    int64_t hp = h + v * dt / 1000000;
+    int64_t r = ((int64_t)z << 16) - hp;
+    h = hp + ((r * ka) >> 16);
+    v += (r * kb) >> 16;
+}
+
+altimeter::altimeter(/* args */)
+{
+}
+
+altimeter::~altimeter()
+{
+}
+
+void altimeter::update(uint64_t t, int32_t pressure, int32_t temperature)
+{
+    filter.update(t, model.altitude(pressure, temperature));
+    updates++;
+}
+
+size_t altimeter::process(const sample *in, size_t n, sample *out, size_t max)
+{
+    size_t k = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const sample &s = in[i];
+        int32_t temperature, pressure;
+
+        switch (channel_kind(s.channel))
+        {
+        case Kind::MS5607_D1:
+            d1_ts = s.timestamp;
+            d1 = s.value;
+            continue;
+        case Kind::MS5607_D2:
+            // D1 and D2 of one reading share the timestamp
+            if (baro == nullptr || d1_ts != s.timestamp)
+                continue;
+            baro->compensate(d1, s.value, temperature, pressure);
+            baro_t = temperature;
+            break;
+        case Kind::BARO_T:
+            baro_t = s.value;
+            continue;
+        case Kind::BARO_P:
+            pressure = s.value;
+            break;
+        default:
+            continue;
+        }
+
+        update(s.timestamp, pressure, baro_t);
+        if (k + 2 > max)
+            continue;
+        out[k++] = {s.timestamp, make_channel(channel_node(s.channel), Kind::ALTITUDE), altitude()};
+        out[k++] = {s.timestamp, make_channel(channel_node(s.channel), Kind::VSPEED), speed()};
+    }
+    return k;
+}
+
+// Pressure [0.01 mbar] at an altitude [mm], inverse of ms5607::altitude()
+static double pressure_at(double h, double temperature, double p0)
+{
+    return p0 / pow(h / 1000 / (153.84615 * (temperature + 273.15)) + 1, 1 / 0.19);
+}
+
+// Standard normal, sum of twelve uniforms, deterministic
+static double noise()
+{
+    double s = 0;
+    for (int i = 0; i < 12; i++)
+        s += rand() / (double)RAND_MAX;
+    return s - 6;
+}
+
+void altimeter_benchmark(uint32_t n)
+{
+    real_clock wall;
+    altimeter alt;
+    volatile float sink = 0;
+    const uint64_t dt = 10000;       // 100 Hz
+    const double climb = 2000;       // [mm/s]
+    const double p_noise = 2.4;      // MS5607 at OSR 4096 [0.01 mbar]
+    const int32_t temperature = 2000;
+    const uint32_t phase = 1500;     // 15 s
+    const uint32_t settle = 300;     // 3 s after every change of speed
+
+    // Lift cycle: hover, climb 30 m, hover, descend
+    if (n < 4 * phase)
+        n = 4 * phase;
+    std::vector<int32_t> p(n), z(n);
+    std::vector<double> truth(n), speed(n);
+    srand(1);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint32_t k = i % (4 * phase), seg = k / phase, in = k % phase;
+        double s = in * dt * 1e-6, top = phase * dt * 1e-6 * climb;
+        truth[i] = seg == 0 ? 0 : seg == 1 ? climb * s : seg == 2 ? top : top - climb * s;
+        speed[i] = seg == 1 ? climb : seg == 3 ? -climb : 0;
+        p[i] = lround(pressure_at(truth[i], temperature * 0.01, 101325) + p_noise * noise());
+    }
+
+    uint64_t t0 = wall.now_us();
+    for (uint32_t i = 0; i < n; i++)
+        sink = sink + ms5607::altitude(p[i] * 0.01f, temperature * 0.01f);
+    uint64_t t1 = wall.now_us();
+    for (uint32_t i = 0; i < n; i++)
+        z[i] = alt.model.altitude(p[i], temperature);
+    uint64_t t2 = wall.now_us();
+    for (uint32_t i = 0; i < n; i++)
+        alt.filter.update(i * dt, z[i]);
+    uint64_t t3 = wall.now_us();
+    alt.filter.reset();
+
+    uint64_t t4 = wall.now_us();
+    for (uint32_t i = 0; i < n; i++)
+        alt.update(i * dt, p[i], temperature);
+    uint64_t t5 = wall.now_us();
+    alt.filter.reset();
+
+    double raw2 = 0, filt2 = 0, speed2 = 0;
+    uint32_t settled = 0, lag = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        alt.update(i * dt, p[i], temperature);
+        // Accuracy after the filter settled, outside the transients
+        if (i % phase >= settle)
+        {
+            double e = z[i] - truth[i];
+            raw2 += e * e;
+            e = alt.altitude() - truth[i];
+            filt2 += e * e;
+            e = alt.speed() - speed[i];
+            speed2 += e * e;
+            settled++;
+        }
+        if (i >= phase && lag == 0 && alt.speed() >= 0.9 * climb)
+            lag = i - phase;
+    }
+
+    double err = 0;
+    for (int32_t q = ALT_P_MIN; q <= ALT_P_MAX; q += 7)
+    {
+        double ref = 153.84615 * (pow(101325.0 / q, 0.19) - 1) * (temperature * 0.01 + 273.15) * 1000;
+        err = fmax(err, fabs(alt.model.altitude(q, temperature) - ref));
+    }
+
+    printf("ALT: %u samples, ns per sample: pow() %.1f, table %.1f, filter %.1f, stage %.1f\n", n,
+           (t1 - t0) * 1000.0 / n, (t2 - t1) * 1000.0 / n, (t3 - t2) * 1000.0 / n, (t5 - t4) * 1000.0 / n);
+    printf("ALT: Table error max %.1f mm over %d..%d mbar\n", err, ALT_P_MIN / 100, ALT_P_MAX / 100);
+    printf("ALT: Noise %.0f mm raw, %.0f mm filtered, speed %.0f mm/s RMS, alpha %.4f beta %.6f\n",
+           sqrt(raw2 / settled), sqrt(filt2 / settled), sqrt(speed2 / settled), alt.filter.alpha, alt.filter.beta);
+    printf("ALT: 2 m/s climb at 90 %% after %.2f s\n", lag * dt * 1e-6);
+    (void)sink;
+}
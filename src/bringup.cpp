@@ -0,0 +1,68 @@
+/*
+ * File:     bringup.cpp
+ * Notes:    Overlapped device initialisation
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "bringup.hpp"
+#include "clock.hpp"
+#include <algorithm>
+#include <stdio.h>
+
+bringup::bringup(/* args */)
+{
+}
+
+bringup::~bringup()
+{
+}
+
+void bringup::add(const char *alias, std::function<int()> begin, uint32_t settle_us, std::function<int()> finish)
+{
+    steps.push_back({alias, begin, settle_us, finish, 0, 0});
+}
+
+int bringup::run()
+{
+    uint64_t start = clk()->now_us();
+    std::vector<step *> order;
+    int failed = 0;
+
+    // Phase 1: reset everything back to back
+    for (auto &s : steps)
+    {
+        s.status = s.begin ? s.begin() : 0;
+        s.deadline = clk()->now_us() + s.settle_us;
+        if (s.status < 0)
+        {
+            printf("%s: ERROR - Bring-up start\n", s.alias);
+            failed++;
+        }
+        else
+            order.push_back(&s);
+    }
+
+    // Phase 2: finish every device as soon as it is ready
+    std::stable_sort(order.begin(), order.end(),
+                     [](const step *a, const step *b) { return a->deadline < b->deadline; });
+    for (auto s : order)
+    {
+        uint64_t now = clk()->now_us();
+        if (now < s->deadline)
+            clk()->sleep_us(s->deadline - now);
+
+        s->status = s->finish ? s->finish() : 0;
+        if (s->status < 0)
+        {
+            printf("%s: ERROR - Bring-up finish\n", s->alias);
+            failed++;
+        }
+    }
+
+    elapsed_us = clk()->now_us() - start;
+    printf("BRINGUP: %zu devices in %llu us, %d failed\n", steps.size(), (unsigned long long)elapsed_us, failed);
+    return failed;
+}
@@ -0,0 +1,53 @@
+/*
+ * File:     clock.cpp
+ * Notes:    Injectable time source, real or virtual
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "clock.hpp"
+#include <time.h>
+#include <errno.h>
+
+static real_clock system_time;
+static i_clock *current = &system_time;
+
+i_clock *clk()
+{
+    return current;
+}
+
+void set_clock(i_clock *c)
+{
+    current = c ? c : &system_time;
+}
+
+uint64_t real_clock::now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint64_t real_clock::wall_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void real_clock::sleep_us(uint64_t us)
+{
+    struct timespec ts = {(time_t)(us / 1000000), (long)(us % 1000000) * 1000};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+void real_clock::sleep_until(uint64_t t)
+{
+    struct timespec ts = {(time_t)(t / 1000000), (long)(t % 1000000) * 1000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
@@ -0,0 +1,98 @@
+/*
+ * File:     config.cpp
+ * Notes:    INI style configuration file
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "config.hpp"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *config_section::get(const char *key, const char *def) const
+{
+    for (auto &kv : keys)
+        if (kv.first == key)
+            return kv.second.c_str();
+    return def;
+}
+
+int config_section::get(const char *key, long long &value) const
+{
+    const char *s = get(key);
+    if (s == nullptr)
+        return 0;
+
+    char *end;
+    errno = 0;
+    long long v = strtoll(s, &end, 0);
+    if (errno != 0 || end == s || *end != '\0')
+        return -1;
+    value = v;
+    return 0;
+}
+
+static char *trim(char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'))
+        end--;
+    *end = '\0';
+    return s;
+}
+
+int config_load(const char *path, std::vector<config_section> &out)
+{
+    char line[256];
+    int n = 0;
+
+    FILE *f = fopen(path, "r");
+    if (f == nullptr)
+    {
+        printf("CONFIG: Can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    out.clear();
+    while (fgets(line, sizeof(line), f))
+    {
+        n++;
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        char *s = trim(line);
+        if (*s == '\0' || *s == ';')
+            continue;
+
+        if (*s == '[')
+        {
+            char *close = strchr(s, ']');
+            if (close == nullptr || close[1] != '\0')
+                break;
+            *close = '\0';
+            out.push_back({trim(s + 1), {}});
+            continue;
+        }
+
+        char *eq = strchr(s, '=');
+        if (eq == nullptr || out.empty())
+            break;
+        *eq = '\0';
+        out.back().keys.push_back({trim(s), trim(eq + 1)});
+    }
+
+    bool eof = feof(f);
+    fclose(f);
+    if (not eof)
+    {
+        printf("CONFIG: ERROR - %s:%d: Syntax error\n", path, n);
+        return -1;
+    }
+    return 0;
+}
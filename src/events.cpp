@@ -0,0 +1,181 @@
+/*
+ * File:     events.cpp
+ * Notes:    ALERT pin events from the GPIO character device
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "events.hpp"
+#include <linux/gpio.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+gpio_events::gpio_events(/* args */)
+{
+}
+
+gpio_events::~gpio_events()
+{
+    Close();
+}
+
+int gpio_events::add(uint32_t line, Edge edge)
+{
+    if (nlines >= EVENT_LINES_MAX)
+        return -1;
+    lines[nlines] = line;
+    edges[nlines] = edge;
+    nlines++;
+    return 0;
+}
+
+int gpio_events::Open()
+{
+    struct gpio_v2_line_request req;
+    struct epoll_event ev;
+
+    if (nlines == 0)
+        return -1;
+
+    int chip_fd = open(chip, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0)
+    {
+        printf("GPIO: Can't open %s: %s\n", chip, strerror(errno));
+        return -1;
+    }
+
+    // All lines are inputs, the edges are set per line through attributes
+    memset(&req, 0, sizeof(req));
+    strncpy(req.consumer, consumer, sizeof(req.consumer) - 1);
+    req.num_lines = nlines;
+    req.event_buffer_size = EVENT_BATCH * 4;
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    for (uint32_t i = 0; i < nlines; i++)
+    {
+        req.offsets[i] = lines[i];
+        uint64_t flags = GPIO_V2_LINE_FLAG_INPUT;
+        if (edges[i] != Edge::FALLING)
+            flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+        if (edges[i] != Edge::RISING)
+            flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+
+        // One attribute per distinct flag set
+        uint32_t a = 0;
+        while (a < req.config.num_attrs && req.config.attrs[a].attr.flags != flags)
+            a++;
+        if (a == req.config.num_attrs)
+        {
+            req.config.attrs[a].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+            req.config.attrs[a].attr.flags = flags;
+            req.config.num_attrs++;
+        }
+        req.config.attrs[a].mask |= 1ULL << i;
+    }
+
+    int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chip_fd);
+    if (ret < 0)
+    {
+        printf("GPIO: ERROR - Line request on %s: %s\n", chip, strerror(errno));
+        return -1;
+    }
+    line_fd = req.fd;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.fd = line_fd;
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, line_fd, &ev) < 0)
+    {
+        printf("GPIO: ERROR - epoll: %s\n", strerror(errno));
+        Close();
+        return -1;
+    }
+    printf("GPIO: %u lines requested on %s\n", nlines, chip);
+    return 0;
+}
+
+void gpio_events::Close()
+{
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    if (line_fd >= 0)
+        close(line_fd);
+    epoll_fd = -1;
+    line_fd = -1;
+}
+
+int gpio_events::wait(line_event *ev, int max, uint64_t timeout_us)
+{
+    struct gpio_v2_line_event raw[EVENT_BATCH];
+    struct epoll_event ready;
+
+    if (epoll_fd < 0)
+        return -1;
+
+    // epoll has ms resolution, round up so a deadline is never missed early
+    int timeout_ms = (int)((timeout_us + 999) / 1000);
+    int n = epoll_wait(epoll_fd, &ready, 1, timeout_ms);
+    if (n < 0)
+        return errno == EINTR ? 0 : -1;
+    if (n == 0)
+        return 0;
+
+    if (max > EVENT_BATCH)
+        max = EVENT_BATCH;
+    ssize_t len = read(line_fd, raw, max * sizeof(raw[0]));
+    if (len < 0)
+        return errno == EAGAIN ? 0 : -1;
+
+    int count = len / sizeof(raw[0]);
+    for (int i = 0; i < count; i++)
+    {
+        ev[i].line = raw[i].offset;
+        ev[i].rising = raw[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+        ev[i].timestamp = raw[i].timestamp_ns / 1000;
+    }
+    return count;
+}
+
+alert_dispatcher::alert_dispatcher(/* args */)
+{
+}
+
+alert_dispatcher::~alert_dispatcher()
+{
+}
+
+void alert_dispatcher::on(uint32_t line, std::function<void(const line_event &)> handler)
+{
+    handlers.push_back({line, handler});
+}
+
+int alert_dispatcher::dispatch(uint64_t timeout_us)
+{
+    line_event ev[EVENT_BATCH];
+
+    if (source == nullptr)
+        return -1;
+
+    int n = source->wait(ev, EVENT_BATCH, timeout_us);
+    for (int i = 0; i < n; i++)
+    {
+        bool handled = false;
+        for (auto &h : handlers)
+        {
+            if (h.first != ev[i].line)
+                continue;
+            h.second(ev[i]);
+            handled = true;
+        }
+        unhandled += not handled;
+        events++;
+    }
+    return n;
+}
@@ -0,0 +1,215 @@
+/*
+ * File:     fusion.cpp
+ * Notes:    Derived environmental quantities from SHT3x and MS5607 samples
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "fusion.hpp"
+#include <math.h>
+#include <string.h>
+
+// Magnus constants over water, Sonntag 1990, -45..60 °C
+#define MAGNUS_A  17.62f
+#define MAGNUS_B  243.12f // [°C]
+#define MAGNUS_E0 6.112f  // [mbar]
+
+#define R_DRY    287.058f // specific gas constant dry air [J/(kg K)]
+#define R_VAPOUR 461.495f // specific gas constant water vapour [J/(kg K)]
+#define KELVIN   273.15f
+
+void derive::dew_point(const float *__restrict t, const float *__restrict rh, float *__restrict dew, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        float g = fast_log(rh[i] * 0.01f) + MAGNUS_A * t[i] / (MAGNUS_B + t[i]);
+        dew[i] = MAGNUS_B * g / (MAGNUS_A - g);
+    }
+}
+
+void derive::abs_humidity(const float *__restrict t, const float *__restrict rh, float *__restrict ah,
+                          float *__restrict e, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        float es = MAGNUS_E0 * fast_exp(MAGNUS_A * t[i] / (MAGNUS_B + t[i]));
+        float ev = es * rh[i] * 0.01f;
+        // ideal gas, e in Pa, result in g/m³
+        ah[i] = ev * (100.0f * 1000.0f / R_VAPOUR) / (t[i] + KELVIN);
+        e[i] = ev;
+    }
+}
+
+void derive::air_density(const float *__restrict t, const float *__restrict p, const float *__restrict e,
+                         float *__restrict rho, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        // dry air and vapour partial pressures, mbar to Pa
+        rho[i] = ((p[i] - e[i]) * (100.0f / R_DRY) + e[i] * (100.0f / R_VAPOUR)) / (t[i] + KELVIN);
+    }
+}
+
+fusion::fusion(/* args */)
+{
+}
+
+fusion::~fusion()
+{
+}
+
+void fusion::add_sht3x(const sample &s)
+{
+    size_t i = count;
+
+    // Temperature and humidity of one measurement share the timestamp
+    if (count && ts[count - 1] == s.timestamp && node[count - 1] == channel_node(s.channel))
+        i = count - 1;
+    else
+    {
+        if (count == FUSION_ROWS)
+        {
+            // Consumer too slow, forget the oldest row
+            memmove(ts, ts + 1, (count - 1) * sizeof(ts[0]));
+            memmove(node, node + 1, (count - 1) * sizeof(node[0]));
+            memmove(t, t + 1, (count - 1) * sizeof(t[0]));
+            memmove(rh, rh + 1, (count - 1) * sizeof(rh[0]));
+            memmove(p, p + 1, (count - 1) * sizeof(p[0]));
+            count--;
+            i = count;
+            dropped++;
+        }
+        ts[i] = s.timestamp;
+        node[i] = channel_node(s.channel);
+        t[i] = NAN;
+        rh[i] = NAN;
+        p[i] = NAN;
+        count++;
+    }
+
+    uint16_t code = (uint16_t)s.value;
+    if (channel_kind(s.channel) == Kind::SHT3X_T)
+        t[i] = -45.0f + 175.0f * code / 65535.0f;
+    else
+        rh[i] = 100.0f * (code ? code : 1) / 65535.0f; // dew point needs RH > 0
+}
+
+void fusion::add_pressure(uint64_t ts, float pressure)
+{
+    if (p_count == 2)
+    {
+        p_ts[0] = p_ts[1];
+        p_val[0] = p_val[1];
+        p_count = 1;
+    }
+    p_ts[p_count] = ts;
+    p_val[p_count] = pressure;
+    p_count++;
+}
+
+bool fusion::resolve(size_t i, bool force)
+{
+    uint64_t now = ts[i];
+
+    // No pressure yet, p stays NaN and density is skipped
+    if (p_count == 0)
+        return force;
+
+    uint8_t last = p_count - 1;
+    if (now > p_ts[last])
+    {
+        // Wait for the pressure after this row
+        if (not force)
+            return false;
+        p[i] = p_val[last];
+        return true;
+    }
+
+    if (p_count == 1 || now <= p_ts[0])
+    {
+        p[i] = p_val[0];
+        return true;
+    }
+
+    // p_ts[0] < now <= p_ts[1]
+    float w = (float)(now - p_ts[0]) / (float)(p_ts[1] - p_ts[0]);
+    p[i] = p_val[0] + w * (p_val[1] - p_val[0]);
+    return true;
+}
+
+size_t fusion::emit(size_t n, sample *out)
+{
+    float dew[FUSION_ROWS], ah[FUSION_ROWS], e[FUSION_ROWS], rho[FUSION_ROWS];
+    size_t k = 0;
+
+    derive::dew_point(t, rh, dew, n);
+    derive::abs_humidity(t, rh, ah, e, n);
+    derive::air_density(t, p, e, rho, n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (isnan(t[i]) || isnan(rh[i]))
+        {
+            dropped++;
+            continue;
+        }
+        out[k++] = {ts[i], make_channel(node[i], Kind::DEW_POINT), (int32_t)lrintf(dew[i] * 100.0f)};
+        out[k++] = {ts[i], make_channel(node[i], Kind::ABS_HUMIDITY), (int32_t)lrintf(ah[i] * 1000.0f)};
+        if (not isnan(rho[i]))
+            out[k++] = {ts[i], make_channel(node[i], Kind::AIR_DENSITY), (int32_t)lrintf(rho[i] * 1e6f)};
+        rows++;
+    }
+    return k;
+}
+
+size_t fusion::process(const sample *in, size_t n, sample *out, size_t max)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const sample &s = in[i];
+        if (s.timestamp > newest)
+            newest = s.timestamp;
+
+        switch (channel_kind(s.channel))
+        {
+        case Kind::SHT3X_T:
+        case Kind::SHT3X_RH:
+            add_sht3x(s);
+            break;
+        case Kind::MS5607_D1:
+            d1_ts = s.timestamp;
+            d1 = s.value;
+            break;
+        case Kind::MS5607_D2:
+            // D1 and D2 of one reading share the timestamp
+            if (baro && d1_ts == s.timestamp)
+                add_pressure(s.timestamp, baro->pressure(d1, s.value));
+            break;
+        case Kind::BARO_P:
+            add_pressure(s.timestamp, s.value * 0.01f);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Ready prefix, up to three samples per row
+    size_t ready = 0;
+    while (ready < count && (ready + 1) * 3 <= max &&
+           resolve(ready, newest - ts[ready] > max_wait_us))
+        ready++;
+    if (ready == 0)
+        return 0;
+
+    size_t k = emit(ready, out);
+
+    count -= ready;
+    memmove(ts, ts + ready, count * sizeof(ts[0]));
+    memmove(node, node + ready, count * sizeof(node[0]));
+    memmove(t, t + ready, count * sizeof(t[0]));
+    memmove(rh, rh + ready, count * sizeof(rh[0]));
+    memmove(p, p + ready, count * sizeof(p[0]));
+    return k;
+}
@@ -0,0 +1,232 @@
+/*
+ * File:     i2c_trace.cpp
+ * Notes:    I2C transaction recorder and replay backend
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "i2c_trace.hpp"
+#include "clock.hpp"
+#include <endian.h>
+
+static uint64_t now_ns()
+{
+    return clk()->now_us() * 1000;
+}
+
+// The file is little endian whatever the host, a trace recorded on the
+// board replays on a big endian build host
+static void put16(FILE *f, uint16_t v)
+{
+    v = htole16(v);
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static void put32(FILE *f, uint32_t v)
+{
+    v = htole32(v);
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static void put64(FILE *f, uint64_t v)
+{
+    v = htole64(v);
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+static bool get16(FILE *f, uint16_t &v)
+{
+    if (fread(&v, sizeof(v), 1, f) != 1)
+        return false;
+    v = le16toh(v);
+    return true;
+}
+
+static bool get32(FILE *f, uint32_t &v)
+{
+    if (fread(&v, sizeof(v), 1, f) != 1)
+        return false;
+    v = le32toh(v);
+    return true;
+}
+
+static bool get64(FILE *f, uint64_t &v)
+{
+    if (fread(&v, sizeof(v), 1, f) != 1)
+        return false;
+    v = le64toh(v);
+    return true;
+}
+
+i2c_recorder::i2c_recorder(/* args */)
+{
+}
+
+i2c_recorder::~i2c_recorder()
+{
+    Close();
+}
+
+int i2c_recorder::Open(const std::string &path)
+{
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("TRACE: Can't create %s: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    put32(file, TRACE_MAGIC);
+    put16(file, TRACE_VERSION);
+    put16(file, 0); // reserved
+    start = 0;
+    transactions = 0;
+    printf("TRACE: Record to %s\n", path.c_str());
+    return 0;
+}
+
+void i2c_recorder::Close()
+{
+    if (file == NULL)
+        return;
+    fclose(file);
+    file = NULL;
+    printf("TRACE: %llu transactions recorded\n", (unsigned long long)transactions);
+}
+
+void i2c_recorder::record(const struct i2c_msg *msgs, uint32_t nmsgs, int ret)
+{
+    if (file == NULL)
+        return;
+
+    uint64_t now = now_ns();
+    if (transactions == 0)
+        start = now;
+
+    put64(file, now - start);
+    put32(file, (uint32_t)ret);
+    put16(file, nmsgs);
+    for (uint32_t i = 0; i < nmsgs; i++)
+    {
+        put16(file, msgs[i].addr);
+        put16(file, msgs[i].flags);
+        put16(file, msgs[i].len);
+        fwrite(msgs[i].buf, 1, msgs[i].len, file);
+    }
+    transactions++;
+}
+
+i2c_replay::i2c_replay(/* args */)
+{
+}
+
+i2c_replay::~i2c_replay()
+{
+}
+
+int i2c_replay::Open(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+    {
+        printf("TRACE: Can't open %s: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    uint32_t magic = 0;
+    uint16_t version = 0, reserved;
+    if (not get32(file, magic) || not get16(file, version) || not get16(file, reserved) || magic != TRACE_MAGIC || version != TRACE_VERSION)
+    {
+        printf("TRACE: ERROR - %s is not a trace\n", path.c_str());
+        fclose(file);
+        return -1;
+    }
+
+    trace.clear();
+    messages.clear();
+    data.clear();
+
+    transaction t;
+    uint32_t ret;
+    while (get64(file, t.time) && get32(file, ret) && get16(file, t.nmsgs))
+    {
+        t.ret = (int32_t)ret;
+        t.first = messages.size();
+        for (uint16_t i = 0; i < t.nmsgs; i++)
+        {
+            uint16_t hdr[3];
+            if (not get16(file, hdr[0]) || not get16(file, hdr[1]) || not get16(file, hdr[2]))
+                break;
+            message m = {hdr[0], hdr[1], hdr[2], (uint32_t)data.size()};
+            data.resize(data.size() + m.len);
+            if (fread(data.data() + m.offset, 1, m.len, file) != m.len)
+                break;
+            messages.push_back(m);
+        }
+        if (messages.size() != t.first + t.nmsgs)
+        {
+            printf("TRACE: Truncated record %zu ignored\n", trace.size());
+            break;
+        }
+        trace.push_back(t);
+    }
+    fclose(file);
+
+    printf("TRACE: Loaded %zu transactions from %s\n", trace.size(), path.c_str());
+    rewind();
+    return 0;
+}
+
+void i2c_replay::rewind()
+{
+    next = 0;
+    start = 0;
+}
+
+int i2c_replay::transfer(struct i2c_msg *msgs, uint32_t nmsgs)
+{
+    if (done())
+    {
+        if (not loop || trace.empty())
+            return -1;
+        rewind();
+    }
+
+    const transaction &t = trace[next++];
+    if (realtime)
+    {
+        if (start == 0)
+            start = now_ns() - t.time;
+        uint64_t due = start + t.time;
+        uint64_t now = now_ns();
+        if (due > now)
+            clk()->sleep_us((due - now) / 1000);
+    }
+
+    bool match = t.nmsgs == nmsgs;
+    for (uint32_t i = 0; match && i < nmsgs; i++)
+    {
+        const message &m = messages[t.first + i];
+        match = m.addr == msgs[i].addr && m.flags == msgs[i].flags && m.len == msgs[i].len;
+        if (match && not(m.flags & I2C_M_RD))
+            match = memcmp(data.data() + m.offset, msgs[i].buf, m.len) == 0;
+    }
+    if (not match)
+    {
+        if (mismatches++ == 0)
+            printf("TRACE: ERROR - Transaction %zu differs from recording\n", next - 1);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < nmsgs; i++)
+    {
+        const message &m = messages[t.first + i];
+        if (m.flags & I2C_M_RD)
+            memcpy(msgs[i].buf, data.data() + m.offset, m.len);
+        bytes += m.len;
+    }
+    replayed++;
+    return t.ret;
+}
@@ -8,6 +8,8 @@
  */
 
 #include "i_i2c.hpp"
+#include "tca9548a.hpp"
+#include "clock.hpp"
 
 i_i2c::i_i2c(/* args */)
 {
@@ -19,11 +21,18 @@ i_i2c::~i_i2c()
 
 int i_i2c::Open()
 {
-    printf("%s: Open device %s\n", alias.c_str(), device.c_str());
-    fd = open(device.c_str(), O_RDWR);
+    if (backend)
+    {
+        printf("%s: Open device %s on backend\n", alias, device);
+        fd = -1;
+        return 0;
+    }
+
+    printf("%s: Open device %s\n", alias, device);
+    fd = open(device, O_RDWR);
     if (fd < 0)
     {
-        printf("%s: Can't open %s: %s\n", alias.c_str(), device.c_str(), strerror(errno));
+        printf("%s: Can't open %s: %s\n", alias, device, strerror(errno));
         return -1;
     }
     return 0;
@@ -31,30 +40,85 @@ int i_i2c::Open()
 
 int i_i2c::Close()
 {
-    if (fd > 0)
+    if (fd >= 0)
     {
-        printf("%s: Close device %s\n", alias.c_str(), device.c_str());
-        return close(fd);
+        printf("%s: Close device %s\n", alias, device);
+        int ret = close(fd);
+        fd = -1;
+        return ret;
     }
     return 0;
 }
 
+int i_i2c::GeneralCallReset()
+{
+    struct i2c_msg msg;
+    uint8_t cmd = 0x06;
 
+    msg.addr = 0x00;
+    msg.flags = 0;
+    msg.len = 1;
+    msg.buf = &cmd;
+    return Transfer(&msg, 1);
+}
 
-int i_i2c::Read(uint16_t reg, uint8_t *buf, uint16_t size)
+int i_i2c::Transfer(struct i2c_msg *msgs, uint32_t nmsgs)
 {
     struct i2c_rdwr_ioctl_data data;
-    struct i2c_msg *msgs = NULL;
+    int ret;
+
+    if (mux && mux->select(mux_channel) < 0)
+        return -1;
+
+    uint64_t start = clk()->now_us();
+    if (backend)
+        ret = backend->transfer(msgs, nmsgs);
+    else
+    {
+        data.msgs = msgs;
+        data.nmsgs = nmsgs;
+        ret = ioctl(fd, I2C_RDWR, &data);
+    }
+    count(clk()->now_us() - start, ret < 0);
+
+    if (tap)
+        tap->record(msgs, nmsgs, ret);
+
+    // A bus fault may have reset the mux, a NACK of the device doesn't
+    if (mux && ret < 0 && errno != ENXIO && errno != EREMOTEIO)
+        mux->invalidate();
+    return ret;
+}
+
+void i_i2c::count(uint64_t us, bool failed)
+{
+    int b = 0;
+    while (b < I2C_LATENCY_BUCKETS - 1 && us > LATENCY_BOUNDS_US[b])
+        b++;
+
+    // Relaxed, readers only need each counter to be consistent on its own
+    __atomic_fetch_add(&latency[b], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latency_us, us, __ATOMIC_RELAXED);
+    if (failed)
+        __atomic_fetch_add(&errors, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&transactions, 1, __ATOMIC_RELAXED);
+}
+
+uint16_t i_i2c::node() const
+{
+    if (mux == nullptr)
+        return address;
+    return address | (mux_channel + 1) << 7 | (mux->i2c->address & 0x07) << 11;
+}
+
+int i_i2c::Read(uint16_t reg, uint8_t *buf, uint16_t size)
+{
+    struct i2c_msg msgs[2];
     uint8_t reg_buf[sizeof(reg)] = {0};
-    int ret = -1;
+    int ret;
 
     reg_buf[0] = (uint8_t)(reg >> 8);
     reg_buf[1] = (uint8_t)(reg & 0xFF);
-    memset(&data, 0, sizeof(data));
-    msgs = (i2c_msg *)calloc(2, sizeof(struct i2c_msg));
-    if (NULL == msgs)
-        return ret;
-
     msgs[0].addr = address;
     msgs[0].flags = 0;
     msgs[0].len = sizeof(reg);
@@ -63,11 +127,7 @@ int i_i2c::Read(uint16_t reg, uint8_t *buf, uint16_t size)
     msgs[1].flags = I2C_M_RD;
     msgs[1].len = size;
     msgs[1].buf = buf;
-    data.msgs = msgs;
-    data.nmsgs = 2;
-
-    ret = ioctl(fd, I2C_RDWR, &data);
-    free(msgs);
+    ret = Transfer(msgs, 2);
 
     // for (int i = 0; i < size; ++i)
     //     printf("%02x ", buf[i]);
@@ -3,92 +3,932 @@
 #include "sht3x.hpp"
 #include "ms5607.hpp"
 #include "pac193x.hpp"
+#include "recovery.hpp"
+#include "bringup.hpp"
+#include "store.hpp"
+#include "shm_table.hpp"
+#include "aggregator.hpp"
+#include "i2c_trace.hpp"
+#include "clock.hpp"
+#include "sim_bus.hpp"
+#include "rt.hpp"
+#include "snapshot.hpp"
+#include "fusion.hpp"
+#include "events.hpp"
+#include "sysfs.hpp"
+#include "record.hpp"
+#include "rate_controller.hpp"
+#include "telemetry.hpp"
+#include "acquisition.hpp"
+#include "altimeter.hpp"
+#include "metrics.hpp"
+#include "tca9548a.hpp"
+#include "sht3x_registry.hpp"
+#include <signal.h>
 
 #define SHT3X 1
 #define MS5607 1
+#define PAC193X 1
+#define STORE 0
+#define SHM 0 // Publish latest values to /dev/shm for other processes, always with -m
+#define AGGREGATE 0 // Print decimated min/max/mean/stddev per channel
+#define FUSION 0 // Derive dew point, absolute humidity and air density
+#define ALTIMETER 0 // Filtered altitude and vertical speed from the MS5607
 #define CNTR 1
+#define PERIOD_US (1000 * 1000) // Acquisition period
 
-int main(/*int argc, char *argv[]*/)
+#define IIC_DEVICE "/dev/i2c-2"
+#define PROM_CACHE_DIR "" // MS5607 calibration cache directory, empty to disable
+#define STORE_DIR "/var/lib/sht3x"
+#define AGGREGATE_PERIOD_US (10 * 1000 * 1000)
+#define ALT_NOISE_MM 200.0f    // Altitude noise of the MS5607 at OSR 4096
+#define ALT_ACCEL_MM_S2 1000.0f // Expected vertical acceleration
+
+// Event mode, reads are triggered by the ALERT pins
+#define GPIO_CHIP "/dev/gpiochip0"
+#define SHT3X_ALERT_LINE 17   // GPIO line of the SHT3x ALERT pin
+#define PAC193X_ALERT_LINE 27 // GPIO line of the PAC193x ALERT pin
+
+// SHT3x ALERT limits, alert above t [°C] or rh [%], cleared 1 °C and 2 % below
+struct alert_limits
+{
+    float t;
+    float rh;
+};
+static const alert_limits SHT3X_ALERT = {30.0f, 70.0f};
+static const alert_limits SIM_SHT3X_ALERT = {23.0f, 50.0f}; // Crossed by the simulated day
+
+// Adaptive mode, rate and precision follow the activity of the signals.
+// Noise relative to the first level, datasheet repeatability of SHT3x
+// temperature 0.04/0.08/0.15 °C and MS5607 RMS noise 0.024/0.054/0.13 mbar
+static const rate_level SHT3X_LEVELS[] = {
+    {2000000, "0.5 mps, high", 1.0f}, {1000000, "1 mps, high", 1.0f}, {500000, "2 mps, medium", 2.0f},
+    {250000, "4 mps, medium", 2.0f}, {100000, "10 mps, low", 3.75f}};
+static const Frequency SHT3X_FRQ[] = {Frequency::PERIODIC_05, Frequency::PERIODIC_1, Frequency::PERIODIC_2,
+                                      Frequency::PERIODIC_4, Frequency::PERIODIC_10};
+static const Repeatability SHT3X_RPT[] = {Repeatability::HIGH, Repeatability::HIGH, Repeatability::MEDIUM,
+                                          Repeatability::MEDIUM, Repeatability::LOW};
+static const rate_level MS5607_LEVELS[] = {
+    {4000000, "OSR 4096", 1.0f}, {1000000, "OSR 4096", 1.0f}, {250000, "OSR 1024", 2.25f},
+    {100000, "OSR 256", 5.4f}};
+static const uint16_t MS5607_OSR[] = {4096, 4096, 1024, 256};
+static const rate_level PAC193X_LEVELS[] = {
+    {2000000, "8 sps"}, {1000000, "64 sps"}, {250000, "256 sps"}, {100000, "1024 sps"}};
+
+// Kernel mode, the devices are owned by the hwmon and IIO drivers
+#define IIO_DEV_ROOT "/dev"
+#define IIO_TRIGGER "" // Buffer trigger, empty to keep the configured one
+
+// Fleet mode, identical SHT3x behind muxes read through the registry
+#define FLEET_DEVICE "/dev/i2c-3" // Bus of the fleet
+#define FLEET_MUXES 4             // Muxes from MUX_ADDR up, 0x44 and 0x45 on every channel
+#define FLEET_MAX (FLEET_MUXES * MUX_CHANNELS * 2)
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-n count] [-i us] [-R prio] [-c cpu] [-r trace] [-p trace [-f]] [-s] [-S] [-e] [-k root] [-a] [-m addr] [-F count] [-A t,rh]\n", name);
+    printf("  -n count  Number of acquisition cycles (default %d)\n", CNTR);
+    printf("  -i us     Acquisition period (default %d)\n", PERIOD_US);
+    printf("  -R prio   Real-time: lock memory, SCHED_FIFO priority\n");
+    printf("  -c cpu    Real-time: pin bus thread to CPU\n");
+    printf("  -r trace  Record all I2C transactions to trace\n");
+    printf("  -p trace  Replay trace instead of using %s\n", IIC_DEVICE);
+    printf("  -f        Replay as fast as possible\n");
+    printf("  -s        Simulated devices in virtual time\n");
+    printf("  -S        Coherent snapshots, all devices triggered together\n");
+    printf("  -e        Read SHT3x and PAC193x only when their ALERT pin signals\n");
+    printf("  -A t,rh   SHT3x ALERT above t °C or rh %% (default %.0f,%.0f, simulated %.0f,%.0f)\n", SHT3X_ALERT.t,
+           SHT3X_ALERT.rh, SIM_SHT3X_ALERT.t, SIM_SHT3X_ALERT.rh);
+    printf("  -k root   Devices owned by kernel drivers, read from sysfs under root\n");
+    printf("  -a        Adapt rate and precision of every device to signal activity\n");
+    printf("  -t path   Stream samples in binary frames on a Unix socket at path\n");
+    printf("  -d config Daemon: devices from config, SIGHUP reloads it without stopping\n");
+    printf("  -B count  Benchmark the altitude estimator on count synthetic readings\n");
+    printf("  -m addr   Serve OpenMetrics on a port of 127.0.0.1 or a Unix socket path\n");
+    printf("  -F count  Also read count SHT3x behind muxes on %s, up to %d\n", FLEET_DEVICE, FLEET_MAX);
+}
+
+static volatile sig_atomic_t reload_requested = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    if (sig == SIGHUP)
+        reload_requested = 1;
+    else
+        stop_requested = 1;
+}
+
+// Daemon mode, the topology comes from the configuration instead of the
+// defines above and a reload only touches the devices that changed
+static int run_daemon(const char *path, std::function<void(i_i2c &)> attach, std::function<void(i_i2c &)> detach,
+                      shm_publisher *latest, telemetry_publisher *tlm, int cntr)
+{
+    acquisition acq;
+    sample batch[SNAPSHOT_SAMPLES];
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    acq.attach = attach;
+    acq.detach = detach;
+    if (acq.load(path, clk()->now_us()) < 0)
+        return 1;
+
+    // Runs until SIGINT or SIGTERM, or for cntr wake-ups if given
+    while (not stop_requested && cntr != 0)
+    {
+        if (reload_requested)
+        {
+            reload_requested = 0;
+            printf("MAIN: Reload %s\n", path);
+            acq.load(path, clk()->now_us());
+        }
+
+        size_t n = acq.run(clk()->now_us(), sample_time(), batch, SNAPSHOT_SAMPLES);
+        for (size_t i = 0; i < n; i++)
+            printf("----- %08x: %.3f %s\n", batch[i].channel, to_unit(batch[i]),
+                   kind_scale(channel_kind(batch[i].channel)).unit);
+        if (latest)
+            latest->publish(batch, n);
+        if (tlm)
+        {
+            tlm->publish(batch, n);
+            tlm->flush();
+        }
+
+        if (cntr > 0)
+            cntr--;
+        clk()->sleep_until(acq.next_wakeup(clk()->now_us()));
+    }
+
+    printf("MAIN: %u reloads, %u devices added, %u removed, %u changed\n", acq.reloads, acq.added,
+           acq.removed, acq.changed);
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
     int cntr = CNTR;
-    i_i2c i2c; // Main i2c interface
-    printf("MAIN: Set IIC Parameters\n");
-    i2c.alias = "IIC";
-    i2c.device = "/dev/i2c-2";
-    
-    printf("MAIN: Open IIC Device\n");
-    i2c.Open();
+    bringup boot; // All devices are reset at once
+    i2c_recorder recorder;
+    i2c_replay replay;
+    real_clock wall;       // Benchmark time, real even in simulation
+    virtual_clock vclock;  // Simulation time
+    sim_bus simulation;
+    bool recording = false, replaying = false, fast = false, simulating = false;
+    bool coherent = false, events = false, adaptive = false;
+    rate_controller rate;
+    const char *sysfs_root = nullptr;
+    const char *config_path = nullptr;
+    bool counted = false; // -n given
+    telemetry_publisher tlm;
+    bool streaming = false;
+    metrics_exporter exporter;
+    bool exporting = false;
+    shm_publisher latest;
+    bool publishing = false;
+    size_t fleet_size = 0;
+    alert_limits limits;
+    bool limits_given = false;
+    snapshot snap;
+    uint64_t period = PERIOD_US;
+    rt_config rt;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:i:R:c:r:p:fsSek:at:d:B:m:F:A:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            cntr = atoi(optarg);
+            counted = true;
+            break;
+        case 'i':
+            period = strtoull(optarg, NULL, 0);
+            break;
+        case 'R':
+            rt.priority = atoi(optarg);
+            break;
+        case 'c':
+            rt.cpu = atoi(optarg);
+            break;
+        case 'r':
+            recording = recorder.Open(optarg) == 0;
+            break;
+        case 'p':
+            replaying = replay.Open(optarg) == 0;
+            break;
+        case 'f':
+            fast = true;
+            break;
+        case 's':
+            simulating = true;
+            break;
+        case 'S':
+            coherent = true;
+            break;
+        case 'e':
+            events = true;
+            break;
+        case 'k':
+            sysfs_root = optarg;
+            break;
+        case 'a':
+            adaptive = true;
+            break;
+        case 't':
+            tlm.path = optarg;
+            streaming = tlm.Open() == 0;
+            break;
+        case 'd':
+            config_path = optarg;
+            break;
+        case 'B':
+            altimeter_benchmark(strtoul(optarg, NULL, 0));
+            return 0;
+        case 'm':
+            exporter.endpoint = optarg;
+            exporting = exporter.Start() == 0;
+            break;
+        case 'A':
+            if (sscanf(optarg, "%f,%f", &limits.t, &limits.rh) != 2)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            limits_given = true;
+            break;
+        case 'F':
+            fleet_size = strtoul(optarg, NULL, 0);
+            if (fleet_size > FLEET_MAX)
+                fleet_size = FLEET_MAX;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    replay.realtime = not fast;
+    // The simulated signal never reaches the limits of a real room
+    if (not limits_given)
+        limits = simulating ? SIM_SHT3X_ALERT : SHT3X_ALERT;
+    if (coherent && events)
+    {
+        printf("MAIN: Snapshots trigger all devices, event mode ignored\n");
+        events = false;
+    }
+    if (config_path && (coherent || events || sysfs_root || adaptive))
+    {
+        printf("MAIN: Daemon mode polls the configured devices, -S, -e, -k and -a ignored\n");
+        coherent = events = adaptive = false;
+        sysfs_root = nullptr;
+    }
+    bool kernel = sysfs_root != nullptr;
+    if ((kernel || config_path) && fleet_size)
+    {
+        printf("MAIN: The fleet is read in polling mode only, -F ignored\n");
+        fleet_size = 0;
+    }
+    if (kernel && (coherent || events || simulating || adaptive))
+    {
+        printf("MAIN: Kernel drivers own the devices, -S, -e, -s and -a ignored\n");
+        coherent = events = simulating = adaptive = false;
+    }
+    if (adaptive && (coherent || events))
+    {
+        printf("MAIN: Adaptive rates need polling, -a ignored\n");
+        adaptive = false;
+    }
+    uint64_t started = wall.now_us();
+
+    // The exporter serves the latest values from the table
+    if (SHM || exporting)
+        publishing = latest.Open() == 0;
+
+    // Before devices are opened, so everything allocated later is locked too
+    if (rt.priority > 0 || rt.cpu >= 0)
+        rt_setup(rt);
+
+    sim_device *sim_sht3x_dev = nullptr, *sim_pac193x_dev = nullptr;
+    if (simulating)
+    {
+        // Sleeps advance virtual time, hours of acquisition run in seconds
+        set_clock(&vclock);
+        simulation.vclock = &vclock;
+        simulation.add(sim_sht3x_dev = new sim_sht3x(ADDR_1));
+        simulation.add(new sim_ms5607(0x76));
+        simulation.add(sim_pac193x_dev = new sim_pac193x(0x10));
+        // Humidity sensors behind a mux, for configurations with mux and channel
+        sim_tca9548a *sim_mux = new sim_tca9548a(MUX_ADDR);
+        simulation.add(sim_mux);
+        for (uint8_t ch = 0; ch < 2; ch++)
+            simulation.add(new sim_sht3x(ADDR_2), sim_mux, ch);
+    }
+
+    // Route a device interface through the trace recorder and/or replay
+    auto attach = [&](i_i2c &bus)
+    {
+        if (simulating)
+            bus.backend = &simulation;
+        if (replaying)
+            bus.backend = &replay;
+        if (recording)
+            bus.tap = &recorder;
+        if (exporting)
+            exporter.add(&bus);
+    };
+    auto detach = [&](i_i2c &bus)
+    {
+        if (exporting)
+            exporter.remove(&bus);
+    };
+
+    if (config_path)
+    {
+        int ret = run_daemon(config_path, attach, detach, publishing ? &latest : nullptr,
+                             streaming ? &tlm : nullptr, counted ? cntr : -1);
+        exporter.Stop();
+        recorder.Close();
+        printf("MAIN: Done\n");
+        return ret;
+    }
 
+    // Every device gets its own interface so the address is never shared
+    // between devices and a recovering device doesn't disturb the others
 #if SHT3X
-    i2c.address = 0x44; // For sht3x
-    
+    i_i2c i2c_sht3x;
     float temperature;
     float humidity;
     sht3x snsr; // Humidity and Temperature Sensor
+    recovery rec_sht3x;
 
-    printf("MAIN: Init Sensor\n");
-    snsr.i2c = &i2c;
-    snsr.init();
+    printf("MAIN: Set IIC Parameters\n");
+    i2c_sht3x.alias = "SHT3X";
+    i2c_sht3x.device = IIC_DEVICE;
+    i2c_sht3x.address = ADDR_1;
+    attach(i2c_sht3x);
+    if (not kernel)
+        i2c_sht3x.Open();
+    snsr.i2c = &i2c_sht3x;
 
-    if (snsr.single(&temperature, &humidity) == 0)
-        printf("SHT3x Sensor: %.2f °C, %.2f %%\n", temperature, humidity);
+    boot.add("SHT3X", [&]() { return snsr.soft_reset(); }, RESET_DURATION_US,
+             [&]() { return snsr.get_status(); });
 
-    // Start periodic measurements with 1 measurement per second.
-    snsr.start(Frequency::PERIODIC_1, Repeatability::HIGH);
-    snsr.sleep(Repeatability::HIGH);
+    rec_sht3x.alias = "SHT3X";
+    rec_sht3x.i2c = &i2c_sht3x;
+    rec_sht3x.settle_us = RESET_DURATION_US;
+    rec_sht3x.soft_reset = [&]() { return snsr.soft_reset(); };
 
-    while (0 < cntr--)
+    // Limits are lost on reset, set again after every recovery
+    auto arm_sht3x = [&]()
     {
-        if (snsr.get_results(&temperature, &humidity) == 0)
-            printf("----- Sensor: %.2f °C, %.2f %%\n", temperature, humidity);
-        else
-            printf("SHT3x Error");
-        sleep(1);
-    }
+        if (snsr.set_alert_limit(AlertLimit::HIGH_SET, limits.t, limits.rh) < 0)
+            return -1;
+        return snsr.set_alert_limit(AlertLimit::HIGH_CLEAR, limits.t - 1, limits.rh - 2);
+    };
+    bool sht3x_alert = false;
+
+    // Mode restarted by recovery, changed by the rate controller
+    Frequency sht3x_frq = Frequency::PERIODIC_1;
+    Repeatability sht3x_rpt = Repeatability::HIGH;
 
-    snsr.stop();
+    rec_sht3x.probe = [&]()
+    {
+        if (snsr.get_status() < 0 || (events && arm_sht3x() < 0))
+            return -1;
+        return coherent ? 0 : snsr.start(sht3x_frq, sht3x_rpt);
+    };
+    int snap_sht3x = snap.add(&snsr);
 #endif
 
 #if MS5607
+    i_i2c i2c_ms5607;
     ms5607 s_ms5607;
-    i2c.address = 0x76; // For ms5607
-    s_ms5607.i2c = &i2c;
-    float P_val,T_val,H_val;
-    s_ms5607.init();
+    float P_val, T_val, H_val;
+    recovery rec_ms5607;
 
-    cntr = CNTR;
-    while (0 < cntr--)
-    {
-        if (s_ms5607.read())
-        {
-            T_val = s_ms5607.get_temperature();
-            P_val = s_ms5607.get_pressure();
-            H_val = s_ms5607.get_altitude();
+    i2c_ms5607.alias = "MS5607";
+    i2c_ms5607.device = IIC_DEVICE;
+    i2c_ms5607.address = 0x76; // For ms5607
+    attach(i2c_ms5607);
+    if (not kernel)
+        i2c_ms5607.Open();
+    s_ms5607.i2c = &i2c_ms5607;
+    s_ms5607.cache_dir = PROM_CACHE_DIR;
 
-            printf("----- Temperature: %.2f °C\n", T_val);
-            printf("----- Pressure: %.2f mBar\n", P_val);
-            printf("----- Altitude: %.2f meter\n", H_val);
-        }
-        else
-            printf("MS5607 Error");
-        sleep(1);
-    }
+    boot.add("MS5607", [&]() { return s_ms5607.soft_reset() ? 0 : -1; }, RESET_DELAY_US,
+             [&]() { return s_ms5607.calibration() ? 0 : -1; });
 
+    rec_ms5607.alias = "MS5607";
+    rec_ms5607.i2c = &i2c_ms5607;
+    rec_ms5607.settle_us = RESET_DELAY_US;
+    rec_ms5607.soft_reset = [&]() { return s_ms5607.soft_reset() ? 0 : -1; };
+    rec_ms5607.probe = [&]() { return s_ms5607.calibration() ? 0 : -1; };
+    int snap_ms5607 = snap.add(&s_ms5607);
 #endif
+
+#if PAC193X
+    i_i2c i2c_pac193x;
     pac193x pac193x;
-    i2c.address = 0x10; // pac193x
-    pac193x.i2c = &i2c;
-    // pac193x.init();
+    recovery rec_pac193x;
+
+    i2c_pac193x.alias = "PAC193X";
+    i2c_pac193x.device = IIC_DEVICE;
+    i2c_pac193x.address = 0x10; // pac193x
+    attach(i2c_pac193x);
+    if (not kernel)
+        i2c_pac193x.Open();
+    pac193x.i2c = &i2c_pac193x;
+    boot.add("PAC193X", [&]() { return pac193x.refresh() ? 0 : -1; }, REFRESH_DELAY_US,
+             [&]() { return pac193x.init() ? 0 : -1; });
 
 //     for (uint8_t i = 0; i < 3; i++)
 //         printf("pac193x: CH %d direction Voltage: %d Current: %d\n", i + 1, pac193x.get_voltage_drct(i), pac193x.get_current_drct(i));
 
 // sleep(5);
 
-    for (uint8_t i = 0; i < 3; i++)
-        printf("pac193x: CH %d\tmean voltage: %f[V]\tmean current: %f[mA]\n", i + 1, pac193x.get_bus_voltage(i, true), pac193x.get_current(i, true));
+    rec_pac193x.alias = "PAC193X";
+    rec_pac193x.i2c = &i2c_pac193x;
+    rec_pac193x.settle_us = REFRESH_DELAY_US;
+    rec_pac193x.soft_reset = [&]() { return pac193x.refresh() ? 0 : -1; };
+    // Sample rate re-applied by recovery, changed by events and the rate controller
+    pac193x_base::SampleRate pac193x_rate = pac193x_base::SampleRate::SPS_1024;
+
+    // Directions are read back, bipolar channels decode with them. CTRL is
+    // lost on a power cycle, the rate and the event ALERTs are set again.
+    rec_pac193x.probe = [&]()
+    {
+        if (not pac193x.init() || not pac193x.set_sample_rate(pac193x_rate))
+            return -1;
+        return not events || pac193x.set_alert(true, true) ? 0 : -1;
+    };
+    int snap_pac193x = snap.add(&pac193x);
+    bool pac193x_ready = false;
+#endif
+
+    // One interface per mux channel, the registry addresses the devices
+    i_i2c fleet_mux_i2c[FLEET_MUXES];
+    tca9548a fleet_mux[FLEET_MUXES];
+    i_i2c fleet_bus[FLEET_MUXES * MUX_CHANNELS];
+    sim_bus fleet_sim;
+    sim_tca9548a *fleet_sim_mux[FLEET_MUXES];
+    sht3x_registry fleet;
+    sample fleet_batch[2 * FLEET_MAX];
+    fleet_sim.vclock = &vclock;
+    for (size_t c = 0; c < (fleet_size + 1) / 2; c++)
+    {
+        size_t m = c / MUX_CHANNELS;
+        if (c % MUX_CHANNELS == 0)
+        {
+            fleet_mux_i2c[m].alias = "TCA9548A";
+            fleet_mux_i2c[m].device = FLEET_DEVICE;
+            fleet_mux_i2c[m].address = MUX_ADDR + m;
+            attach(fleet_mux_i2c[m]);
+            if (simulating)
+                fleet_mux_i2c[m].backend = &fleet_sim;
+            fleet_mux_i2c[m].Open();
+            fleet_mux[m].i2c = &fleet_mux_i2c[m];
+            if (simulating)
+                fleet_sim.add(fleet_sim_mux[m] = new sim_tca9548a(MUX_ADDR + m));
+        }
+
+        i_i2c &bus = fleet_bus[c];
+        bus.alias = "FLEET";
+        bus.device = FLEET_DEVICE;
+        bus.address = ADDR_1;
+        bus.mux = &fleet_mux[m];
+        bus.mux_channel = c % MUX_CHANNELS;
+        attach(bus);
+        if (simulating)
+            bus.backend = &fleet_sim;
+        bus.Open();
+        fleet.buses.push_back(&bus);
+    }
+    for (size_t i = 0; i < fleet_size; i++)
+    {
+        uint8_t addr = i % 2 ? ADDR_2 : ADDR_1;
+        fleet.add(i / 2, addr);
+        if (simulating)
+            fleet_sim.add(new sim_sht3x(addr), fleet_sim_mux[i / 2 / MUX_CHANNELS], i / 2 % MUX_CHANNELS);
+    }
+
+    // Kernel drivers instead of the I2C drivers, same samples
+#if SHT3X
+    hwmon_sht3x k_sht3x;
+    k_sht3x.root = sysfs_root;
+    k_sht3x.node = i2c_sht3x.node();
+#endif
+#if MS5607
+    iio_ms5607 k_ms5607;
+    k_ms5607.root = sysfs_root;
+    k_ms5607.dev_root = IIO_DEV_ROOT;
+    k_ms5607.trigger = IIO_TRIGGER;
+    k_ms5607.node = i2c_ms5607.node();
+#endif
+#if PAC193X
+    iio_pac193x k_pac193x(pac193x::CHANNELS, true);
+    k_pac193x.root = sysfs_root;
+    k_pac193x.dev_root = IIO_DEV_ROOT;
+    k_pac193x.trigger = IIO_TRIGGER;
+    k_pac193x.node = i2c_pac193x.node();
+#endif
+    if (kernel)
+    {
+#if SHT3X
+        k_sht3x.Open();
+#endif
+#if MS5607
+        k_ms5607.Open();
+#endif
+#if PAC193X
+        k_pac193x.Open();
+#endif
+    }
+
+    printf("MAIN: Init Sensors\n");
+    if (not kernel)
+        boot.run();
+    if (fleet.size())
+    {
+        fleet.soft_reset();
+        clk()->sleep_us(RESET_DURATION_US);
+        fleet.start(Frequency::PERIODIC_1, Repeatability::HIGH);
+    }
+
+#if SHT3X
+    if (not kernel && snsr.single(&temperature, &humidity) == 0)
+        printf("SHT3x Sensor: %.2f °C, %.2f %%\n", temperature, humidity);
+
+    // Start periodic measurements with 1 measurement per second,
+    // snapshots trigger single shots instead
+    if (events)
+        arm_sht3x();
+    if (not coherent && not kernel)
+    {
+        snsr.start(sht3x_frq, sht3x_rpt);
+        snsr.sleep(sht3x_rpt);
+    }
+#endif
+
+    // Start at the fixed rates of the other modes, level 1
+    int rate_sht3x = -1, rate_ms5607 = -1, rate_pac193x = -1;
+    if (adaptive)
+    {
+#if SHT3X
+        rate_sht3x = rate.add("SHT3X", SHT3X_LEVELS, 5, [&](int l)
+        {
+            sht3x_frq = SHT3X_FRQ[l];
+            sht3x_rpt = SHT3X_RPT[l];
+            snsr.stop();
+            return snsr.start(sht3x_frq, sht3x_rpt);
+        });
+        // Allowed noise at high repeatability, about four times the sensor's
+        rate.watch(rate_sht3x, make_channel(i2c_sht3x.node(), Kind::SHT3X_T), 0.15f, 0.01f);
+        rate.watch(rate_sht3x, make_channel(i2c_sht3x.node(), Kind::SHT3X_RH), 0.5f, 0.05f);
+        sht3x_frq = SHT3X_FRQ[1];
+        rate.set_level(rate_sht3x, 1, clk()->now_us());
+#endif
+#if MS5607
+        rate_ms5607 = rate.add("MS5607", MS5607_LEVELS, 4, [&](int l)
+        {
+            s_ms5607.setOSR(MS5607_OSR[l]);
+            return 0;
+        });
+        // Allowed noise at OSR 4096, about four times the sensor's
+        rate.watch(rate_ms5607, make_channel(i2c_ms5607.node(), Kind::BARO_P), 0.1f, 0.01f);
+        rate.set_level(rate_ms5607, 1, clk()->now_us());
+#endif
+#if PAC193X
+        rate_pac193x = rate.add("PAC193X", PAC193X_LEVELS, 4, [&](int l)
+        {
+            pac193x_rate = (pac193x_base::SampleRate)(3 - l);
+            return pac193x.set_sample_rate(pac193x_rate) ? 0 : -1;
+        });
+        for (uint8_t i = 0; i < pac193x::CHANNELS; i++)
+            rate.watch(rate_pac193x, make_channel(i2c_pac193x.node(), Kind::PAC_VSENSE, i), 2500.0f, 5000.0f);
+        rate.set_level(rate_pac193x, 1, clk()->now_us());
+#endif
+    }
+
+    // ALERT pins on GPIO lines, or the pins of the simulated devices
+    gpio_events gpio;
+    sim_events sim_alerts;
+    alert_dispatcher dispatcher;
+    if (events)
+    {
+        gpio.chip = GPIO_CHIP;
+        dispatcher.source = &gpio;
+        if (simulating)
+            dispatcher.source = &sim_alerts;
+#if SHT3X
+        gpio.add(SHT3X_ALERT_LINE, Edge::BOTH);
+        sim_alerts.add(SHT3X_ALERT_LINE, sim_sht3x_dev);
+        dispatcher.on(SHT3X_ALERT_LINE, [&](const line_event &ev)
+        {
+            printf("EVENT: SHT3X alert %s at %llu us\n", ev.rising ? "set" : "cleared",
+                   (unsigned long long)ev.timestamp);
+            sht3x_alert = true;
+        });
+#endif
+#if PAC193X
+        // One conversion complete pulse every 125 ms, overflows as they come
+        pac193x_rate = pac193x_base::SampleRate::SPS_8;
+        pac193x.set_sample_rate(pac193x_rate);
+        pac193x.set_alert(true, true);
+        gpio.add(PAC193X_ALERT_LINE, Edge::FALLING);
+        sim_alerts.add(PAC193X_ALERT_LINE, sim_pac193x_dev);
+        dispatcher.on(PAC193X_ALERT_LINE, [&](const line_event &) { pac193x_ready = true; });
+#endif
+        if (not simulating && gpio.Open() < 0)
+        {
+            printf("MAIN: ALERT lines unavailable, polling\n");
+            events = false;
+        }
+    }
+
+#if STORE
+    sample_store db;
+    db.dir = STORE_DIR;
+#endif
+#if AGGREGATE
+    aggregator agg;
+    agg.period_us = AGGREGATE_PERIOD_US;
+    agg.emit = [](const aggregate &a)
+    {
+        printf("AGG: %08x %s n=%u min=%.0f max=%.0f mean=%.2f stddev=%.2f\n", a.channel,
+               a.window == aggregate::TUMBLING ? "tumbling" : "rolling",
+               a.count, a.min, a.max, a.mean, a.stddev);
+    };
+#endif
+#if ALTIMETER && MS5607
+    altimeter alt;
+    alt.baro = &s_ms5607;
+    alt.filter.noise_mm = ALT_NOISE_MM;
+    alt.filter.accel_mm_s2 = ALT_ACCEL_MM_S2;
+#endif
+#if FUSION && SHT3X && MS5607
+    fusion fuse;
+    fuse.baro = &s_ms5607;
+    fuse.max_wait_us = 2 * period;
+#endif
+    sample batch[SNAPSHOT_SAMPLES]; // Samples of one loop iteration
+    int nbatch;
+    jitter_histogram jitter(period);
+    uint64_t deadline = clk()->now_us();
+
+    while (0 < cntr--)
+    {
+        uint64_t now = clk()->now_us();
+        uint64_t ts = sample_time();
+        nbatch = 0;
+        jitter.tick(now);
+
+        if (coherent)
+        {
+            snapshot_frame frame;
+#if SHT3X
+            snap.enable(snap_sht3x, rec_sht3x.available());
+#endif
+#if MS5607
+            snap.enable(snap_ms5607, rec_ms5607.available());
+#endif
+#if PAC193X
+            snap.enable(snap_pac193x, rec_pac193x.available());
+#endif
+            if (snap.take(frame) >= 0)
+            {
+                std::copy(frame.samples, frame.samples + frame.count, batch);
+                nbatch = frame.count;
+                printf("SNAPSHOT: %d samples, skew < %u us, ready after %u us\n",
+                       frame.count, frame.skew_us, frame.latency_us);
+            }
+#if SHT3X
+            if (rec_sht3x.available())
+                snap.status(snap_sht3x) < 0 ? rec_sht3x.fault(now) : rec_sht3x.success();
+#endif
+#if MS5607
+            if (rec_ms5607.available())
+                snap.status(snap_ms5607) < 0 ? rec_ms5607.fault(now) : rec_ms5607.success();
+#endif
+#if PAC193X
+            if (rec_pac193x.available())
+                snap.status(snap_pac193x) < 0 ? rec_pac193x.fault(now) : rec_pac193x.success();
+#endif
+        }
+
+        if (kernel)
+        {
+            size_t first = nbatch;
+#if SHT3X
+            nbatch += k_sht3x.read(batch + nbatch, SNAPSHOT_SAMPLES - nbatch);
+#endif
+#if MS5607
+            nbatch += k_ms5607.read(batch + nbatch, SNAPSHOT_SAMPLES - nbatch);
+#endif
+#if PAC193X
+            nbatch += k_pac193x.read(batch + nbatch, SNAPSHOT_SAMPLES - nbatch);
+#endif
+            for (size_t i = first; i < (size_t)nbatch; i++)
+                printf("----- %08x: %.3f %s\n", batch[i].channel, to_unit(batch[i]),
+                       kind_scale(channel_kind(batch[i].channel)).unit);
+        }
+
+#if SHT3X
+        if (not coherent && not kernel && rec_sht3x.available() && (not events || sht3x_alert) &&
+            (not adaptive || rate.due(rate_sht3x, now)))
+        {
+            sht3x_alert = false;
+            uint8_t raw[RAW_DATA_SIZE];
+            if (snsr.get_data(raw) >= 0)
+            {
+                rec_sht3x.success();
+                snsr.parse_data(raw, &temperature, &humidity);
+                batch[nbatch++] = {ts, make_channel(i2c_sht3x.node(), Kind::SHT3X_T), raw[0] << 8 | raw[1]};
+                batch[nbatch++] = {ts, make_channel(i2c_sht3x.node(), Kind::SHT3X_RH), raw[3] << 8 | raw[4]};
+                printf("----- Sensor: %.2f °C, %.2f %%\n", temperature, humidity);
+            }
+            else
+            {
+                rec_sht3x.fault(now);
+                printf("SHT3x Error\n");
+            }
+        }
+        rec_sht3x.poll(now);
+#endif
+
+#if MS5607
+        if (not coherent && not kernel && rec_ms5607.available() && (not adaptive || rate.due(rate_ms5607, now)))
+        {
+            if (s_ms5607.read())
+            {
+                rec_ms5607.success();
+                batch[nbatch++] = {ts, make_channel(i2c_ms5607.node(), Kind::MS5607_D1), (int32_t)s_ms5607.DP};
+                batch[nbatch++] = {ts, make_channel(i2c_ms5607.node(), Kind::MS5607_D2), (int32_t)s_ms5607.DT};
+                T_val = s_ms5607.get_temperature();
+                P_val = s_ms5607.get_pressure();
+                H_val = s_ms5607.get_altitude();
+                if (adaptive)
+                    rate.observe(make_channel(i2c_ms5607.node(), Kind::BARO_P), ts, P_val);
+
+                printf("----- Temperature: %.2f °C\n", T_val);
+                printf("----- Pressure: %.2f mBar\n", P_val);
+                printf("----- Altitude: %.2f meter\n", H_val);
+            }
+            else
+            {
+                rec_ms5607.fault(now);
+                printf("MS5607 Error\n");
+            }
+        }
+        rec_ms5607.poll(now);
+#endif
+
+#if PAC193X
+        if (not coherent && not kernel && rec_pac193x.available() && (not events || pac193x_ready) &&
+            (not adaptive || rate.due(rate_pac193x, now)))
+        {
+            pac193x_ready = false;
+            pac193x::reading r;
+            float voltage[pac193x::CHANNELS], current[pac193x::CHANNELS];
+            // Latch the conversion that raised the ALERT
+            if ((events || adaptive) && pac193x.refresh_v())
+                clk()->sleep_us(REFRESH_DELAY_US);
+            if (pac193x.read(r, true))
+            {
+                rec_pac193x.success();
+                pac193x.decode(r, voltage, current);
+                for (uint8_t i = 0; i < pac193x::CHANNELS; i++)
+                {
+                    batch[nbatch++] = {ts, make_channel(i2c_pac193x.node(), Kind::PAC_VBUS, i), r.vbus[i]};
+                    batch[nbatch++] = {ts, make_channel(i2c_pac193x.node(), Kind::PAC_VSENSE, i), r.vsense[i]};
+                    printf("pac193x: CH %d\tmean voltage: %f[V]\tmean current: %f[mA]\n", i + 1, voltage[i], current[i]);
+                }
+            }
+            else
+                rec_pac193x.fault(now);
+        }
+        rec_pac193x.poll(now);
+#endif
+
+#if FUSION && SHT3X && MS5607
+        size_t derived = fuse.process(batch, nbatch, batch + nbatch, SNAPSHOT_SAMPLES - nbatch);
+        for (size_t i = nbatch; i < nbatch + derived; i++)
+            printf("----- Derived %08x: %d\n", batch[i].channel, batch[i].value);
+        nbatch += derived;
+#endif
+#if ALTIMETER && MS5607
+        size_t heights = alt.process(batch, nbatch, batch + nbatch, SNAPSHOT_SAMPLES - nbatch);
+        for (size_t i = nbatch; i < nbatch + heights; i++)
+            printf("----- %08x: %.3f %s\n", batch[i].channel, to_unit(batch[i]),
+                   kind_scale(channel_kind(batch[i].channel)).unit);
+        nbatch += heights;
+#endif
+        // Too many samples for the batch, published on their own
+        size_t nfleet = fleet.size() ? fleet.poll(now, fleet_batch, 2 * FLEET_MAX) : 0;
+        if (nfleet)
+        {
+            printf("FLEET: %zu of %zu SHT3x read\n", nfleet / 2, fleet.size());
+            if (publishing)
+                latest.publish(fleet_batch, nfleet);
+            if (streaming)
+                tlm.publish(fleet_batch, nfleet);
+        }
+#if STORE
+        db.append(batch, nbatch);
+#endif
+        if (publishing)
+            latest.publish(batch, nbatch);
+#if AGGREGATE
+        agg.push(batch, nbatch);
+#endif
+        if (streaming)
+        {
+            tlm.publish(batch, nbatch);
+            tlm.flush();
+        }
+        if (adaptive)
+        {
+            rate.push(batch, nbatch);
+            rate.update(now);
+            period = rate.tick_us();
+            // The next cycle is scored against the period it runs at
+            jitter.period_us = period;
+        }
+
+        // Absolute deadlines, processing time doesn't add up to drift
+        deadline += period;
+        if (0 < cntr && not (replaying && fast))
+        {
+            // Event mode sleeps in the event source, handlers only set flags
+            for (uint64_t t = clk()->now_us(); events && t < deadline; t = clk()->now_us())
+                if (dispatcher.dispatch(deadline - t) < 0)
+                    break;
+            clk()->sleep_until(deadline);
+        }
+    }
+
+    // Before the interfaces it reads go away
+    exporter.Stop();
+    if (exporting)
+        printf("MAIN: Served %llu scrapes, %llu truncated\n", (unsigned long long)exporter.scrapes,
+               (unsigned long long)exporter.truncated);
+
+#if SHT3X
+    if (not kernel)
+        snsr.stop();
+    printf("MAIN: SHT3X unavailable %llu us in %u outages\n", (unsigned long long)rec_sht3x.downtime_us, rec_sht3x.outages);
+    i2c_sht3x.Close();
+#endif
+    if (fleet.size())
+    {
+        uint64_t failures = 0;
+        for (uint32_t f : fleet.failures)
+            failures += f;
+        fleet.stop();
+        printf("MAIN: Fleet of %zu SHT3x, %llu failed reads\n", fleet.size(), (unsigned long long)failures);
+    }
+    for (size_t c = 0; c < fleet.buses.size(); c++)
+        fleet_bus[c].Close();
+    for (size_t m = 0; m < FLEET_MUXES; m++)
+        fleet_mux_i2c[m].Close();
+#if MS5607
+    printf("MAIN: MS5607 unavailable %llu us in %u outages\n", (unsigned long long)rec_ms5607.downtime_us, rec_ms5607.outages);
+    i2c_ms5607.Close();
+#endif
+#if PAC193X
+    printf("MAIN: PAC193X unavailable %llu us in %u outages\n", (unsigned long long)rec_pac193x.downtime_us, rec_pac193x.outages);
+    i2c_pac193x.Close();
+#endif
+
+    jitter.report("MAIN");
+    if (adaptive)
+        printf("MAIN: %u rate changes\n", rate.changes);
+    if (events)
+        printf("MAIN: %llu ALERT events, %llu unhandled\n", (unsigned long long)dispatcher.events,
+               (unsigned long long)dispatcher.unhandled);
+    if (streaming)
+        printf("MAIN: Streamed %llu samples in %llu frames, %llu dropped\n", (unsigned long long)tlm.sent,
+               (unsigned long long)tlm.frames, (unsigned long long)tlm.dropped);
+    if (coherent)
+        printf("MAIN: %u snapshots, worst skew %u us\n", snap.taken, snap.skew_max_us);
+    recorder.Close();
+    if (replaying)
+    {
+        uint64_t elapsed = wall.now_us() - started;
+        printf("MAIN: Replayed %llu of %zu transactions, %llu mismatches, %llu bytes in %llu us\n",
+               (unsigned long long)replay.replayed, replay.size(), (unsigned long long)replay.mismatches,
+               (unsigned long long)replay.bytes, (unsigned long long)elapsed);
+    }
 
-    i2c.Close();
+    if (simulating)
+        printf("MAIN: Simulated %llu us in %llu us, bus busy %llu us in %llu transactions\n",
+               (unsigned long long)vclock.now_us(), (unsigned long long)(wall.now_us() - started),
+               (unsigned long long)simulation.bus_time_us, (unsigned long long)simulation.transactions);
 
     printf("MAIN: Done\n");
 }
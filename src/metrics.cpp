@@ -0,0 +1,322 @@
+/*
+ * File:     metrics.cpp
+ * Notes:    OpenMetrics text exporter of the latest values and bus counters
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "metrics.hpp"
+#include "record.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define METRICS_EOF "# EOF\n"
+
+static const char *kind_label(Kind k)
+{
+    static const char *const names[] = {"NONE", "SHT3X_T", "SHT3X_RH", "MS5607_D1", "MS5607_D2", "PAC_VBUS",
+                                        "PAC_VSENSE", "DEW_POINT", "ABS_HUMIDITY", "AIR_DENSITY", "BARO_T",
+                                        "BARO_P", "ALTITUDE", "VSPEED"};
+    return (size_t)k < sizeof(names) / sizeof(names[0]) ? names[(size_t)k] : "UNKNOWN";
+}
+
+static uint64_t load(const uint64_t &x)
+{
+    return __atomic_load_n(&x, __ATOMIC_RELAXED);
+}
+
+metrics_exporter::metrics_exporter(/* args */)
+{
+}
+
+metrics_exporter::~metrics_exporter()
+{
+    Stop();
+}
+
+int metrics_exporter::Start()
+{
+    bool local = not endpoint.empty() && endpoint[0] == '/';
+    uint16_t port = endpoint.empty() || local ? METRICS_PORT : atoi(endpoint.c_str());
+
+    if (buf == nullptr)
+        buf = new char[METRICS_BUFFER];
+    latest.resize(SHM_SLOTS);
+    table.name = shm_name;
+
+    fd = socket(local ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        printf("METRICS: Can't create socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int ret;
+    if (local)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (endpoint.size() >= sizeof(addr.sun_path))
+        {
+            close(fd);
+            fd = -1;
+            return -1;
+        }
+        memcpy(addr.sun_path, endpoint.c_str(), endpoint.size());
+        // A stale socket of a previous run would make bind() fail
+        unlink(endpoint.c_str());
+        ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+    else
+    {
+        // Loopback only, the agent runs on the board
+        struct sockaddr_in addr;
+        int one = 1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+    if (ret < 0 || listen(fd, 4) < 0)
+    {
+        printf("METRICS: Can't listen on %s: %s\n", endpoint.c_str(), strerror(errno));
+        close(fd);
+        fd = -1;
+        return -1;
+    }
+
+    wake = eventfd(0, EFD_CLOEXEC);
+    worker = std::thread(&metrics_exporter::run, this);
+    if (local)
+        printf("METRICS: Serve on %s\n", endpoint.c_str());
+    else
+        printf("METRICS: Serve on 127.0.0.1:%u\n", port);
+    return 0;
+}
+
+void metrics_exporter::Stop()
+{
+    if (fd < 0)
+        return;
+
+    uint64_t one = 1;
+    if (write(wake, &one, sizeof(one)) < 0)
+        printf("METRICS: ERROR - Stop: %s\n", strerror(errno));
+    worker.join();
+    close(wake);
+    close(fd);
+    if (not endpoint.empty() && endpoint[0] == '/')
+        unlink(endpoint.c_str());
+    wake = fd = -1;
+    table.Close();
+    delete[] buf;
+    buf = nullptr;
+}
+
+void metrics_exporter::add(const i_i2c *bus)
+{
+    bus_labels b;
+    b.bus = bus;
+    snprintf(b.labels, sizeof(b.labels), "device=\"%s\",node=\"0x%04x\"", bus->alias, bus->node());
+
+    std::lock_guard<std::mutex> guard(lock);
+    buses.push_back(b);
+}
+
+void metrics_exporter::remove(const i_i2c *bus)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < buses.size(); i++)
+        if (buses[i].bus == bus)
+            buses.erase(buses.begin() + i--);
+}
+
+void metrics_exporter::put(const char *fmt, ...)
+{
+    // Room for the terminator is kept, a line that doesn't fit ends the body
+    size_t room = METRICS_BUFFER - sizeof(METRICS_EOF) - used;
+    if (full)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + used, room, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= room)
+        full = true;
+    else
+        used += n;
+}
+
+const char *metrics_exporter::render(size_t &len)
+{
+    if (buf == nullptr)
+        buf = new char[METRICS_BUFFER];
+    used = 0;
+    full = false;
+
+    // Re-opened by the reader when the publisher comes up or restarts
+    size_t n = table.snapshot(latest.data(), latest.size());
+
+    put("# TYPE sensor_value gauge\n# HELP sensor_value Latest value in the unit of its kind\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        const sample &s = latest[i];
+        if (s.timestamp == 0)
+            continue;
+        Kind k = channel_kind(s.channel);
+        put("sensor_value{node=\"0x%04x\",kind=\"%s\",index=\"%u\",unit=\"%s\"} %.7g\n", channel_node(s.channel),
+            kind_label(k), channel_index(s.channel), kind_scale(k).unit, to_unit(s));
+    }
+    put("# TYPE sensor_timestamp_seconds gauge\n# HELP sensor_timestamp_seconds Time of the latest value\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        const sample &s = latest[i];
+        if (s.timestamp == 0)
+            continue;
+        put("sensor_timestamp_seconds{node=\"0x%04x\",kind=\"%s\",index=\"%u\"} %llu.%06llu\n",
+            channel_node(s.channel), kind_label(channel_kind(s.channel)), channel_index(s.channel),
+            (unsigned long long)(s.timestamp / 1000000), (unsigned long long)(s.timestamp % 1000000));
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        put("# TYPE i2c_transactions counter\n# HELP i2c_transactions I2C transactions of the device\n");
+        for (auto &b : buses)
+            put("i2c_transactions_total{%s} %llu\n", b.labels, (unsigned long long)load(b.bus->transactions));
+        put("# TYPE i2c_errors counter\n# HELP i2c_errors Failed I2C transactions, NACK included\n");
+        for (auto &b : buses)
+            put("i2c_errors_total{%s} %llu\n", b.labels, (unsigned long long)load(b.bus->errors));
+        put("# TYPE i2c_latency_seconds histogram\n# HELP i2c_latency_seconds I2C transaction time\n");
+        for (auto &b : buses)
+        {
+            uint64_t total = 0;
+            for (int k = 0; k < I2C_LATENCY_BUCKETS; k++)
+            {
+                total += load(b.bus->latency[k]);
+                if (k < I2C_LATENCY_BUCKETS - 1)
+                    put("i2c_latency_seconds_bucket{%s,le=\"%g\"} %llu\n", b.labels,
+                        i_i2c::LATENCY_BOUNDS_US[k] * 1e-6, (unsigned long long)total);
+                else
+                    put("i2c_latency_seconds_bucket{%s,le=\"+Inf\"} %llu\n", b.labels, (unsigned long long)total);
+            }
+            put("i2c_latency_seconds_count{%s} %llu\n", b.labels, (unsigned long long)total);
+            put("i2c_latency_seconds_sum{%s} %.6f\n", b.labels, load(b.bus->latency_us) * 1e-6);
+        }
+    }
+
+    put("# TYPE metrics_scrapes counter\nmetrics_scrapes_total %llu\n", (unsigned long long)scrapes);
+    if (full)
+        truncated++;
+    memcpy(buf + used, METRICS_EOF, sizeof(METRICS_EOF) - 1);
+    len = used + sizeof(METRICS_EOF) - 1;
+    return buf;
+}
+
+void metrics_exporter::run()
+{
+    // Threads inherit the real-time policy of the bus thread, a scrape
+    // must never delay acquisition
+    struct sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+    struct pollfd fds[2] = {{fd, POLLIN, 0}, {wake, POLLIN, 0}};
+    for (;;)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            printf("METRICS: ERROR - poll: %s\n", strerror(errno));
+            return;
+        }
+        if (fds[1].revents)
+            return;
+
+        int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0)
+            continue;
+        struct timeval tv = {METRICS_TIMEOUT_MS / 1000, (METRICS_TIMEOUT_MS % 1000) * 1000};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        serve(client);
+        close(client);
+    }
+}
+
+void metrics_exporter::serve(int client)
+{
+    char req[1024];
+    size_t got = 0;
+
+    // Only the request line matters, the rest of the head is skipped
+    while (got < sizeof(req) - 1)
+    {
+        ssize_t r = recv(client, req + got, sizeof(req) - 1 - got, 0);
+        if (r <= 0)
+            return;
+        got += r;
+        req[got] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n"))
+            break;
+    }
+
+    char head[192];
+    size_t len = 0;
+    const char *body = "";
+    int hlen;
+    if (strncmp(req, "GET / ", 6) == 0 || strncmp(req, "GET /metrics ", 13) == 0)
+    {
+        scrapes++;
+        body = render(len);
+        hlen = snprintf(head, sizeof(head),
+                        "HTTP/1.1 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; "
+                        "charset=utf-8\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", len);
+    }
+    else
+        hlen = snprintf(head, sizeof(head), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+
+    struct iovec iov[2] = {{head, (size_t)hlen}, {(void *)body, len}};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    while (msg.msg_iovlen > 0)
+    {
+        // A scraper that hung up must not kill the process with SIGPIPE
+        ssize_t w = sendmsg(client, &msg, MSG_NOSIGNAL);
+        if (w < 0)
+            return;
+        // Partial write, skip what went out
+        while (msg.msg_iovlen > 0 && (size_t)w >= msg.msg_iov->iov_len)
+        {
+            w -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0)
+        {
+            msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + w;
+            msg.msg_iov->iov_len -= w;
+        }
+    }
+}
@@ -9,6 +9,7 @@
  */
 
 #include "ms5607.hpp"
+#include "clock.hpp"
 
 ms5607::ms5607(/* args */)
 {
@@ -21,12 +22,20 @@ ms5607::~ms5607()
 // Initialise coefficient by reading calibration data
 int ms5607::init()
 {
-    if (not reset() || calibration())
+    if (not reset() || not calibration())
         return ACTION_FAIL;
     return ACTION_OK;
 }
 
 int ms5607::reset()
+{
+    if (not soft_reset())
+        return ACTION_FAIL;
+    clk()->sleep_us(RESET_DELAY_US); // wait for internal register reload
+    return ACTION_OK;
+}
+
+int ms5607::soft_reset()
 {
     printf("MS5607: Reset device\n");
     int ret = i2c->Write<uint8_t>(RESET);
@@ -35,25 +44,166 @@ int ms5607::reset()
         printf("MS5607: ERROR - Reset device\n");
         return ACTION_FAIL;
     }
-    usleep(3 * 1000); // wait for internal register reload
     return ACTION_OK;
 }
 
 int ms5607::calibration()
 {
-    printf("MS5607: Get calibration stuff\n");
-    if (read_uint16(PROM + 2, C1) &&
-        read_uint16(PROM + 4, C2) &&
-        read_uint16(PROM + 6, C3) &&
-        read_uint16(PROM + 8, C4) &&
-        read_uint16(PROM + 10, C5) &&
-        read_uint16(PROM + 12, C6))
-        return ACTION_OK;
-    else
+    uint16_t prom[PROM_WORDS];
+
+    bool cached = load_cache(prom);
+    if (cached)
     {
-        printf("MS5607: ERROR - Get calibration stuff\n");
+        // The cache saves the PROM read, not the check that the device
+        // answers: the CRC word is read back and must match the cache
+        uint16_t crc;
+        if (not read_uint16(PROM + (PROM_WORDS - 1) * 2, crc))
+        {
+            printf("MS5607: ERROR - Get PROM CRC\n");
+            return ACTION_FAIL;
+        }
+        if (crc == prom[PROM_WORDS - 1])
+            printf("MS5607: Calibration from cache\n");
+        else
+        {
+            printf("MS5607: Cache is of another device\n");
+            cached = false;
+        }
+    }
+    if (not cached)
+    {
+        printf("MS5607: Get calibration stuff\n");
+        if (not read_prom(prom))
+        {
+            printf("MS5607: ERROR - Get calibration stuff\n");
+            return ACTION_FAIL;
+        }
+        if (not prom_valid(prom))
+        {
+            printf("MS5607: ERROR - PROM CRC check failed\n");
+            return ACTION_FAIL;
+        }
+        save_cache(prom);
+    }
+
+    C1 = prom[1];
+    C2 = prom[2];
+    C3 = prom[3];
+    C4 = prom[4];
+    C5 = prom[5];
+    C6 = prom[6];
+    return ACTION_OK;
+}
+
+int ms5607::read_prom(uint16_t prom[PROM_WORDS])
+{
+    struct i2c_msg msgs[PROM_WORDS * 2];
+    uint8_t cmd[PROM_WORDS];
+    uint8_t data[PROM_WORDS][2];
+
+    for (int i = 0; i < PROM_WORDS; i++)
+    {
+        cmd[i] = PROM + i * 2;
+        msgs[i * 2].addr = i2c->address;
+        msgs[i * 2].flags = 0;
+        msgs[i * 2].len = 1;
+        msgs[i * 2].buf = &cmd[i];
+        msgs[i * 2 + 1].addr = i2c->address;
+        msgs[i * 2 + 1].flags = I2C_M_RD;
+        msgs[i * 2 + 1].len = 2;
+        msgs[i * 2 + 1].buf = data[i];
+    }
+
+    if (i2c->Transfer(msgs, PROM_WORDS * 2) < 0)
+        return ACTION_FAIL;
+
+    for (int i = 0; i < PROM_WORDS; i++)
+        prom[i] = data[i][0] << 8 | data[i][1];
+    return ACTION_OK;
+}
+
+uint8_t ms5607::crc4(const uint16_t prom[PROM_WORDS])
+{
+    uint16_t rem = 0;
+
+    for (int cnt = 0; cnt < PROM_WORDS * 2; cnt++)
+    {
+        uint16_t word = prom[cnt >> 1];
+        if (cnt == PROM_WORDS * 2 - 1)
+            word &= 0xFF00; // CRC itself is not covered
+        rem ^= (cnt % 2 == 1) ? (word & 0x00FF) : (word >> 8);
+        for (int bit = 8; bit > 0; bit--)
+            rem = (rem & 0x8000) ? (rem << 1) ^ 0x3000 : (rem << 1);
+    }
+    return (rem >> 12) & 0x000F;
+}
+
+bool ms5607::prom_valid(const uint16_t prom[PROM_WORDS])
+{
+    // an absent or stuck device reads all zeros or all ones, CRC alone passes zeros
+    bool zeros = true, ones = true;
+    for (int i = 1; i < 7; i++)
+    {
+        zeros &= prom[i] == 0x0000;
+        ones &= prom[i] == 0xFFFF;
+    }
+    if (zeros || ones)
+        return false;
+    return crc4(prom) == (prom[7] & 0x000F);
+}
+
+std::string ms5607::cache_path()
+{
+    // keyed by bus and address, e.g. <dir>/ms5607-i2c-2-76.prom
+    const char *bus = strrchr(i2c->device, '/');
+    bus = bus ? bus + 1 : i2c->device;
+    char name[64];
+    snprintf(name, sizeof(name), "/ms5607-%s-%02x.prom", bus, i2c->address);
+    return cache_dir + name;
+}
+
+int ms5607::load_cache(uint16_t prom[PROM_WORDS])
+{
+    if (cache_dir.empty())
+        return ACTION_FAIL;
+
+    int fd = open(cache_path().c_str(), O_RDONLY);
+    if (fd < 0)
+        return ACTION_FAIL;
+
+    ssize_t size = ::read(fd, prom, PROM_WORDS * sizeof(uint16_t));
+    close(fd);
+    if (size != PROM_WORDS * sizeof(uint16_t) || not prom_valid(prom))
+    {
+        printf("MS5607: Ignore invalid cache %s\n", cache_path().c_str());
         return ACTION_FAIL;
     }
+    return ACTION_OK;
+}
+
+int ms5607::save_cache(const uint16_t prom[PROM_WORDS])
+{
+    if (cache_dir.empty())
+        return ACTION_FAIL;
+
+    // write to a temporary file and rename, a crash never leaves a torn cache
+    std::string path = cache_path();
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("MS5607: ERROR - Can't write cache %s: %s\n", tmp.c_str(), strerror(errno));
+        return ACTION_FAIL;
+    }
+
+    ssize_t size = write(fd, prom, PROM_WORDS * sizeof(uint16_t));
+    close(fd);
+    if (size != PROM_WORDS * sizeof(uint16_t) || rename(tmp.c_str(), path.c_str()) < 0)
+    {
+        unlink(tmp.c_str());
+        return ACTION_FAIL;
+    }
+    return ACTION_OK;
 }
 
 int ms5607::read_uint16(uint8_t reg, uint16_t &value)
@@ -71,9 +221,6 @@ int ms5607::read_uint16(uint8_t reg, uint16_t &value)
 
 int ms5607::do_job(uint8_t cmd, unsigned long &value)
 {
-    uint8_t length = 3;
-    uint8_t data[length];
-
     // start conversion
     int ret = i2c->Write<uint8_t>(cmd);
     if (ret < 0)
@@ -81,9 +228,17 @@ int ms5607::do_job(uint8_t cmd, unsigned long &value)
         printf("MS5607: ERROR - Conversion\n");
         return ACTION_FAIL;
     }
-    usleep(CONV_DELAY * 1000);
+    clk()->sleep_us(CONV_DELAY * 1000);
+
+    return read_adc(value);
+}
 
-    ret = i2c->Read<uint8_t>(READ, data, length);
+int ms5607::read_adc(unsigned long &value)
+{
+    uint8_t length = 3;
+    uint8_t data[length];
+
+    int ret = i2c->Read<uint8_t>(READ, data, length);
     if (ret < 0)
         return ACTION_FAIL;
     value = (unsigned long)data[0] * 1 << 16 | (unsigned long)data[1] * 1 << 8 | (unsigned long)data[2];
@@ -102,34 +257,87 @@ int ms5607::read()
     return ACTION_OK;
 }
 
+Status ms5607::trigger()
+{
+    phase = 0;
+    if (i2c->Write<uint8_t>(CONV_D1) < 0)
+        return Status::IO;
+    phase = 1;
+    return Status::OK;
+}
+
+Status ms5607::fetch()
+{
+    if (phase == 0)
+        return Status::STATE;
+
+    unsigned long &value = phase == 1 ? DP : DT;
+    bool d2 = phase == 2;
+    phase = 0;
+    if (not read_adc(value))
+        return Status::IO;
+    if (value == 0)
+        return Status::INVALID;
+    if (d2)
+        return Status::OK;
+
+    if (i2c->Write<uint8_t>(CONV_D2) < 0)
+        return Status::IO;
+    phase = 2;
+    return Status::PENDING;
+}
+
+size_t ms5607::decode(uint64_t ts, sample *out, size_t max) const
+{
+    if (max < SENSOR_SAMPLES)
+        return 0;
+    out[0] = {ts, make_channel(i2c->node(), Kind::MS5607_D1), (int32_t)DP};
+    out[1] = {ts, make_channel(i2c->node(), Kind::MS5607_D2), (int32_t)DT};
+    return SENSOR_SAMPLES;
+}
+
 float ms5607::get_temperature(void)
 {
-    float dT = (float)DT - ((float)C5) * ((int)1 << 8);
-    float TEMP = 2000.0 + dT * ((float)C6) / (float)((long)1 << 23);
-    return TEMP / 100;
+    return temperature(DT);
 }
 
 float ms5607::get_pressure(void)
 {
-    float dT = (float)DT - ((float)C5) * ((int)1 << 8);
-    int64_t OFF = (((int64_t)C2) * ((long)1 << 17)) + dT * ((float)C4) / ((int)1 << 6);
-    int64_t SENS = ((float)C1) * ((long)1 << 16) + dT * ((float)C3) / ((int)1 << 7);
-    float pa = (float)((float)DP / ((long)1 << 15));
-    float pb = (float)(SENS / ((float)((long)1 << 21)));
-    float pc = pa * pb;
-    float pd = (float)(OFF / ((float)((long)1 << 15)));
-    float P = pc - pd;
-    return P / 100;
+    return pressure(DP, DT);
+}
+
+void ms5607::compensate(uint32_t d1, uint32_t d2, int32_t &temp, int32_t &pressure) const
+{
+    // First order compensation of the datasheet, 64 bit integer only
+    int32_t dT = (int32_t)d2 - ((int32_t)C5 << 8);
+    temp = 2000 + (int32_t)(((int64_t)dT * C6) >> 23);
+    int64_t OFF = ((int64_t)C2 << 17) + (((int64_t)C4 * dT) >> 6);
+    int64_t SENS = ((int64_t)C1 << 16) + (((int64_t)C3 * dT) >> 7);
+    pressure = (int32_t)((((int64_t)d1 * SENS >> 21) - OFF) >> 15);
+}
+
+float ms5607::temperature(unsigned long d2) const
+{
+    int32_t temp, pressure;
+    compensate(0, d2, temp, pressure);
+    return temp / 100.0f;
+}
+
+float ms5607::pressure(unsigned long d1, unsigned long d2) const
+{
+    int32_t temp, pressure;
+    compensate(d1, d2, temp, pressure);
+    return pressure / 100.0f;
 }
 
 float ms5607::get_altitude(void)
 {
-    float h, t, p;
-    t = get_temperature();
-    p = get_pressure();
-    p = P0 / p;
-    h = 153.84615 * (pow(p, 0.19) - 1) * (t + 273.15);
-    return h;
+    return altitude(get_pressure(), get_temperature(), P0);
+}
+
+float ms5607::altitude(float pressure, float temperature, float p0)
+{
+    return 153.84615 * (pow(p0 / pressure, 0.19) - 1) * (temperature + 273.15);
 }
 
 void ms5607::setOSR(uint16_t osr)
@@ -8,19 +8,128 @@
  */
 
 #include "pac193x.hpp"
+#include "record.hpp"
+#include <math.h>
 
-pac193x::pac193x()
+pac193x_base::pac193x_base(uint8_t channels) : channels(channels)
 {
 }
 
-pac193x::~pac193x()
+int pac193x_base::refresh()
 {
+    int ret = i2c->Write<uint8_t>(REFRESH);
+    if (ret < 0)
+    {
+        printf("PAC193X: ERROR - Refresh\n");
+        return 0;
+    }
+    return 1;
+}
+
+int pac193x_base::refresh_v()
+{
+    int ret = i2c->Write<uint8_t>(REFRESH_V);
+    if (ret < 0)
+    {
+        printf("PAC193X: ERROR - Refresh V\n");
+        return 0;
+    }
+    return 1;
+}
+
+int pac193x_base::update_ctrl(uint8_t mask, uint8_t value)
+{
+    uint8_t ctrl;
+
+    if (i2c->Read<uint8_t>(CTRL_REG, &ctrl) < 0)
+    {
+        printf("PAC193X: ERROR - Get CTRL\n");
+        return 0;
+    }
+    ctrl = (ctrl & ~mask) | (value & mask);
+    if (i2c->Write<uint8_t>(CTRL_REG, ctrl) < 0)
+    {
+        printf("PAC193X: ERROR - Set CTRL\n");
+        return 0;
+    }
+    return refresh();
+}
+
+int pac193x_base::set_alert(bool conversion, bool overflow)
+{
+    uint8_t value = (conversion ? ALERT_CC : 0) | (overflow ? OVF_ALERT : 0);
+    // ALERT_PIN selects ALERT over SLOW, needed for either source
+    if (value)
+        value |= ALERT_PIN;
+    return update_ctrl(ALERT_PIN | ALERT_CC | OVF_ALERT, value);
 }
 
-int pac193x::init()
+int pac193x_base::set_sample_rate(SampleRate rate)
+{
+    return update_ctrl(SAMPLE_RATE_MASK, (uint8_t)rate << 6);
+}
+
+template <typename Variant>
+pac193x_t<Variant>::pac193x_t() : pac193x_base(CHANNELS)
+{
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
+        set_resistor(ch, 10);
+    // The registers hold the values of the last REFRESH, latch the current ones first
+    for (int mean = 0; mean < 2; mean++)
+        readings[mean].fetch = [this, mean](reading &r)
+        {
+            if (not refresh_v())
+                return -1;
+            clk()->sleep_us(REFRESH_DELAY_US);
+            return read(r, mean) ? 0 : -1;
+        };
+}
+
+template <typename Variant>
+pac193x_t<Variant>::~pac193x_t()
+{
+}
+
+template <typename Variant>
+int pac193x_t<Variant>::set_sample_rate(SampleRate rate)
+{
+    int ret = pac193x_base::set_sample_rate(rate);
+    // Cached readings were averaged at the old rate
+    readings[0].invalidate();
+    readings[1].invalidate();
+    return ret;
+}
+
+template <typename Variant>
+void pac193x_t<Variant>::set_resistor(uint8_t ch, float mohm)
+{
+    R[ch] = mohm;
+    // Full scale current 100 mV / R over 65536 unipolar steps, [mA]
+    current_lsb[ch] = 100.0f / mohm * 1000.0f / 65536.0f;
+    update_scales();
+}
+
+template <typename Variant>
+void pac193x_t<Variant>::update_scales()
+{
+    constexpr float lsb = kind_traits<Kind::PAC_VBUS>::scale;
+
+    // Bipolar codes are signed with twice the step
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
+    {
+        bool vbip = get_voltage_drct(ch);
+        bool cbip = get_current_drct(ch);
+        vbus_sign[ch] = vbip ? 0x8000 : 0;
+        vbus_scale[ch] = vbip ? 2 * lsb : lsb;
+        vsense_sign[ch] = cbip ? 0x8000 : 0;
+        current_scale[ch] = cbip ? 2 * current_lsb[ch] : current_lsb[ch];
+    }
+}
+
+template <typename Variant>
+int pac193x_t<Variant>::init()
 {
     uint8_t value;
-    i2c->address = I2C_ADR;
 
     int ret = i2c->Write<uint8_t>(REFRESH);
     if (ret < 0)
@@ -36,50 +145,57 @@ int pac193x::init()
         return 0;
     }
 
-    if (value != 0x5A) // for PAC1933
+    if (value != PRODUCT_ID)
     {
-        printf("PAC193X: ERROR - ID reg does not match expected\n");
+        printf("PAC193X: ERROR - ID reg 0x%02X does not match expected 0x%02X\n", value, PRODUCT_ID);
         return 0;
     }
 
-    ret = i2c->Write<uint8_t>(CTRL_REG, OVERFLOW);
-    if (ret < 0)
+    // Only the overflow ALERT, the sample rate and ALERT_CC are the caller's
+    if (not update_ctrl(ALERT_PIN | OVF_ALERT, OVERFLOW))
     {
         printf("PAC193X: ERROR - Turn on ALERT on overflow\n");
         return 0;
     }
-    return 1;
-}
 
-int pac193x::set_voltage_drct(uint8_t ch, bool direction)
-{
-    uint8_t value;
-    int ret = i2c->Read<uint8_t>(NEG_PWR, &value);
+    ret = i2c->Read<uint8_t>(NEG_PWR, &neg_pwr);
     if (ret < 0)
     {
-        printf("PAC193X: ERROR - Get Voltage Direction\n");
+        printf("PAC193X: ERROR - Get Directions\n");
         return 0;
     }
-    ret = direction? i2c->Write<uint8_t>(NEG_PWR, (value | (0x08 >> ch))): i2c->Write<uint8_t>(NEG_PWR, (value & ~(0x08 >> ch))); 
+    update_scales();
+    return 1;
+}
+
+template <typename Variant>
+int pac193x_t<Variant>::write_neg_pwr(uint8_t value)
+{
+    int ret = i2c->Write<uint8_t>(NEG_PWR, value);
     if (ret < 0)
-    {
-        printf("PAC193X: ERROR - Set Voltage Direction\n");
         return 0;
-    }
+    neg_pwr = value;
+    update_scales();
     return 1;
 }
 
-int pac193x::set_current_drct(uint8_t ch, bool direction)
+template <typename Variant>
+int pac193x_t<Variant>::set_voltage_drct(uint8_t ch, bool direction)
 {
-    uint8_t value;
-    int ret = i2c->Read<uint8_t>(NEG_PWR, &value);
-    if (ret < 0)
+    uint8_t value = direction ? (neg_pwr | (0x08 >> ch)) : (neg_pwr & ~(0x08 >> ch));
+    if (not write_neg_pwr(value))
     {
-        printf("PAC193X: ERROR - Get Current Direction\n");
+        printf("PAC193X: ERROR - Set Voltage Direction\n");
         return 0;
     }
-    ret = direction ? i2c->Write<uint8_t>(NEG_PWR, (value | (0x80 >> ch))) : i2c->Write<uint8_t>(NEG_PWR, (value & ~(0x80 >> ch)));
-    if (ret < 0)
+    return 1;
+}
+
+template <typename Variant>
+int pac193x_t<Variant>::set_current_drct(uint8_t ch, bool direction)
+{
+    uint8_t value = direction ? (neg_pwr | (0x80 >> ch)) : (neg_pwr & ~(0x80 >> ch));
+    if (not write_neg_pwr(value))
     {
         printf("PAC193X: ERROR - Set Current Direction\n");
         return 0;
@@ -87,43 +203,83 @@ int pac193x::set_current_drct(uint8_t ch, bool direction)
     return 1;
 }
 
-bool pac193x::get_voltage_drct(uint8_t ch)
+template <typename Variant>
+bool pac193x_t<Variant>::get_voltage_drct(uint8_t ch) const
 {
-    uint8_t value;
-    int ret = i2c->Read<uint8_t>(NEG_PWR, &value);
-    if (ret < 0)
+    return (neg_pwr >> (3 - ch)) & 0x01;
+}
+
+template <typename Variant>
+bool pac193x_t<Variant>::get_current_drct(uint8_t ch) const
+{
+    return (neg_pwr >> (7 - ch)) & 0x01;
+}
+
+template <typename Variant>
+int pac193x_t<Variant>::read(reading &r, bool mean)
+{
+    uint8_t buffer[BLOCK_SIZE];
+
+    // VBUS1..n then VSENSE1..n, missing channels are skipped by the device
+    last_status = i2c->Read<uint8_t>(vbus_reg(0, mean), buffer, BLOCK_SIZE) < 0 ? 0 : 1;
+    if (not last_status)
     {
-        printf("PAC193X: ERROR - Get Voltage Direction\n");
+        printf("PAC193X: ERROR - Read block\n");
         return 0;
     }
-    return (value >> (3 - ch)) & 0x01;
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
+    {
+        r.vbus[ch] = buffer[2 * ch] << 8 | buffer[2 * ch + 1];
+        r.vsense[ch] = buffer[2 * (CHANNELS + ch)] << 8 | buffer[2 * (CHANNELS + ch) + 1];
+    }
+    return 1;
 }
 
-bool pac193x::get_current_drct(uint8_t ch)
+template <typename Variant>
+void pac193x_t<Variant>::decode(const reading &r, float voltage[CHANNELS], float current[CHANNELS]) const
 {
-    uint8_t value;
-    int ret = i2c->Read<uint8_t>(NEG_PWR, &value);
-    if (ret < 0)
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
     {
-        printf("PAC193X: ERROR - Get Current Direction\n");
+        voltage[ch] = ((int32_t)(r.vbus[ch] ^ vbus_sign[ch]) - vbus_sign[ch]) * vbus_scale[ch];
+        current[ch] = ((int32_t)(r.vsense[ch] ^ vsense_sign[ch]) - vsense_sign[ch]) * current_scale[ch];
+    }
+}
+
+template <typename Variant>
+size_t pac193x_t<Variant>::decode(uint64_t ts, sample *out, size_t max) const
+{
+    if (max < SENSOR_SAMPLES)
         return 0;
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
+    {
+        out[2 * ch] = {ts, make_channel(i2c->node(), Kind::PAC_VBUS, ch), result.vbus[ch]};
+        out[2 * ch + 1] = {ts, make_channel(i2c->node(), Kind::PAC_VSENSE, ch), result.vsense[ch]};
     }
-    return (value >> (7 - ch)) & 0x01;
+    return SENSOR_SAMPLES;
 }
 
-float pac193x::get_bus_voltage(uint8_t ch, bool mean)
+template <typename Variant>
+float pac193x_t<Variant>::get_bus_voltage(uint8_t ch, bool mean)
 {
-    uint16_t raw = get_voltage_raw(BUS1 + ch, mean);
-    if (get_voltage_drct(ch))
-        return (int16_t)raw * 32 / 32768.0f;
-    else
-        return raw * 32 / 65536.0f;
+    return bus_voltage(ch, get_voltage_raw(BUS1 + ch, mean));
+}
+
+template <typename Variant>
+float pac193x_t<Variant>::bus_voltage(uint8_t ch, uint16_t raw) const
+{
+    return ((int32_t)(raw ^ vbus_sign[ch]) - vbus_sign[ch]) * vbus_scale[ch];
     // Return [V]
 }
 
-float pac193x::get_sense_voltage(uint8_t ch, bool mean)
+template <typename Variant>
+float pac193x_t<Variant>::get_sense_voltage(uint8_t ch, bool mean)
+{
+    return sense_voltage(ch, get_voltage_raw(SENSE1 + ch, mean));
+}
+
+template <typename Variant>
+float pac193x_t<Variant>::sense_voltage(uint8_t ch, uint16_t raw) const
 {
-    uint16_t raw = get_voltage_raw(SENSE1 + ch, mean);
     if (get_voltage_drct(ch))
         return (int16_t)raw * 1.525878906;
     else
@@ -131,14 +287,16 @@ float pac193x::get_sense_voltage(uint8_t ch, bool mean)
     // Return [uV]
 }
 
-uint16_t pac193x::get_voltage_raw(uint8_t reg, bool mean)
+template <typename Variant>
+uint16_t pac193x_t<Variant>::get_voltage_raw(uint8_t reg, bool mean)
 {
     uint16_t voltage = 0;
     uint8_t size = 2;
     uint8_t buffer[size] = {0};
 
-    reg += mean ? 0x08 : 0x00;
-    if (i2c->Read<uint8_t>(reg, buffer, size) < 0)
+    reg += mean ? AVG_OFFSET : 0x00;
+    last_status = i2c->Read<uint8_t>(reg, buffer, size) < 0 ? 0 : 1;
+    if (not last_status)
         printf("PAC193X: ERROR - Read voltage raw\n");
     else
         // memcpy(&voltage, buffer, size);
@@ -146,13 +304,39 @@ uint16_t pac193x::get_voltage_raw(uint8_t reg, bool mean)
     return voltage;
 }
 
-float pac193x::get_current(uint8_t ch, bool mean)
+template <typename Variant>
+float pac193x_t<Variant>::get_current(uint8_t ch, bool mean)
 {
-    float FSC = 100.0f / R[ch]; // Calculate the full scale current, [Amps] using the defined resistor value
-    uint16_t raw = get_voltage_raw(SENSE1 + ch, mean);
-    if (get_current_drct(ch))
-        return (int16_t)raw * FSC * 1000 / 32768.0f;
-    else
-        return raw * FSC * 1000 / 65536.0f;
+    return current(ch, get_voltage_raw(SENSE1 + ch, mean));
+}
+
+template <typename Variant>
+float pac193x_t<Variant>::get_current(uint8_t ch, bool mean, uint64_t max_age_us)
+{
+    reading r;
+    if (readings[mean].get(max_age_us, r) < 0)
+        return NAN;
+    return current(ch, r.vsense[ch]);
+}
+
+template <typename Variant>
+float pac193x_t<Variant>::get_bus_voltage(uint8_t ch, bool mean, uint64_t max_age_us)
+{
+    reading r;
+    if (readings[mean].get(max_age_us, r) < 0)
+        return NAN;
+    return bus_voltage(ch, r.vbus[ch]);
+}
+
+template <typename Variant>
+float pac193x_t<Variant>::current(uint8_t ch, uint16_t raw) const
+{
+    // Step precomputed by set_resistor() and the direction setters
+    return ((int32_t)(raw ^ vsense_sign[ch]) - vsense_sign[ch]) * current_scale[ch];
     // return [mA]
-}
\ No newline at end of file
+}
+
+template class pac193x_t<pac1931>;
+template class pac193x_t<pac1932>;
+template class pac193x_t<pac1933>;
+template class pac193x_t<pac1934>;
@@ -0,0 +1,181 @@
+/*
+ * File:     rate_controller.cpp
+ * Notes:    Activity adaptive sampling rate and precision per device
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "rate_controller.hpp"
+#include "record.hpp"
+#include <math.h>
+#include <stdio.h>
+
+rate_controller::rate_controller(/* args */)
+{
+}
+
+rate_controller::~rate_controller()
+{
+}
+
+int rate_controller::add(const char *alias, const rate_level *levels, int n, std::function<int(int)> apply)
+{
+    if (n < 1 || n > RATE_LEVELS_MAX)
+        return -1;
+
+    device d;
+    d.alias = alias;
+    for (int i = 0; i < n; i++)
+        d.levels[i] = levels[i];
+    d.n = n;
+    d.lo = 0;
+    d.hi = n - 1;
+    d.level = -1; // unknown until set_level()
+    d.apply = apply;
+    d.activity = 0;
+    d.calm_since = 0;
+    d.next = 0;
+    devices.push_back(d);
+    return devices.size() - 1;
+}
+
+void rate_controller::bounds(int dev, int lo, int hi)
+{
+    device &d = devices[dev];
+    d.lo = lo < 0 ? 0 : lo;
+    d.hi = hi >= d.n ? d.n - 1 : hi;
+}
+
+void rate_controller::watch(int dev, uint32_t channel, float noise, float slope)
+{
+    channel_stats c = {};
+    c.channel = channel;
+    c.dev = dev;
+    c.noise = noise;
+    c.slope = slope;
+    stats.push_back(c);
+}
+
+void rate_controller::observe(uint32_t channel, uint64_t t, float value)
+{
+    for (auto &c : stats)
+    {
+        if (c.channel != channel)
+            continue;
+        if (c.count++ == 0)
+        {
+            c.mean = value;
+            c.var = 0;
+            c.rate = 0;
+            c.ref_t = t;
+            c.ref_mean = value;
+        }
+        else
+        {
+            // Exponentially weighted mean and variance
+            float d = value - c.mean;
+            c.mean += alpha * d;
+            c.var = (1 - alpha) * (c.var + alpha * d * d);
+        }
+        if (t >= c.ref_t + horizon_us)
+        {
+            c.rate = (c.mean - c.ref_mean) * 1e6f / (t - c.ref_t);
+            c.ref_t = t;
+            c.ref_mean = c.mean;
+        }
+        c.fresh = true;
+    }
+}
+
+void rate_controller::push(const sample *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        observe(s[i].channel, s[i].timestamp, to_unit(s[i]));
+}
+
+int rate_controller::set_level(int dev, int level, uint64_t now)
+{
+    device &d = devices[dev];
+    level = level < d.lo ? d.lo : level > d.hi ? d.hi : level;
+    if (level == d.level)
+        return 0;
+
+    int from = d.level;
+    if (d.apply && d.apply(level) < 0)
+    {
+        printf("RATE: ERROR - %s level %d (%s)\n", d.alias, level, d.levels[level].label);
+        return -1;
+    }
+    d.level = level;
+    d.calm_since = 0;
+    // First read one new period after the change
+    d.next = now + d.levels[level].period_us;
+    changes++;
+    printf("RATE: %s %d -> %d (%s, %llu ms), activity %.2f\n", d.alias, from, level, d.levels[level].label,
+           (unsigned long long)(d.levels[level].period_us / 1000), d.activity);
+    return 0;
+}
+
+void rate_controller::update(uint64_t now)
+{
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        device &d = devices[i];
+        bool fresh = false;
+        float activity = 0;
+        // Lower precision is noisier, only change beyond that is activity
+        float noise = d.level < 0 ? 1.0f : d.levels[d.level].noise;
+
+        for (auto &c : stats)
+        {
+            if (c.dev != (int)i || c.count < RATE_WARMUP)
+                continue;
+            fresh |= c.fresh;
+            c.fresh = false;
+            // The slope between noisy means is as noisy, its allowance scales too
+            float a = sqrtf(c.var) / (c.noise * noise);
+            float r = fabsf(c.rate) / (c.slope * noise);
+            activity = fmaxf(activity, fmaxf(a, r));
+        }
+        if (not fresh)
+            continue;
+        d.activity = activity;
+
+        // Fast attack, slow decay
+        if (activity > 1.0f)
+        {
+            d.calm_since = 0;
+            if (d.level < d.hi)
+                set_level(i, d.hi, now);
+        }
+        else if (activity >= 0.5f)
+            d.calm_since = 0;
+        else if (d.calm_since == 0)
+            d.calm_since = now;
+        else if (now - d.calm_since >= dwell_us && d.level > d.lo)
+            set_level(i, d.level - 1, now);
+    }
+}
+
+bool rate_controller::due(int dev, uint64_t now)
+{
+    device &d = devices[dev];
+    // Half a loop period early is on time, the loop runs on its own grid
+    if (d.level < 0 || now + tick_us() / 2 < d.next)
+        return false;
+    d.next += d.levels[d.level].period_us;
+    if (d.next <= now)
+        d.next = now + d.levels[d.level].period_us;
+    return true;
+}
+
+uint64_t rate_controller::tick_us() const
+{
+    uint64_t tick = UINT64_MAX;
+    for (auto &d : devices)
+        if (d.level >= 0 && d.levels[d.level].period_us < tick)
+            tick = d.levels[d.level].period_us;
+    return tick;
+}
@@ -0,0 +1,179 @@
+/*
+ * File:     recovery.cpp
+ * Notes:    Per-device fault recovery state machine
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "recovery.hpp"
+
+recovery::recovery(/* args */)
+{
+}
+
+recovery::~recovery()
+{
+}
+
+const char *recovery::state_name(State s)
+{
+    switch (s)
+    {
+    case State::ONLINE:
+        return "ONLINE";
+    case State::SOFT_RESET:
+        return "SOFT_RESET";
+    case State::GENERAL_CALL:
+        return "GENERAL_CALL";
+    case State::SETTLE:
+        return "SETTLE";
+    case State::BACKOFF:
+        return "BACKOFF";
+    case State::OFFLINE:
+        return "OFFLINE";
+    }
+    return "UNKNOWN";
+}
+
+void recovery::set_state(State s)
+{
+    if (s != state)
+        printf("%s: Recovery %s -> %s\n", alias, state_name(state), state_name(s));
+    state = s;
+}
+
+void recovery::success()
+{
+    if (state == State::ONLINE)
+        failures = 0;
+}
+
+void recovery::fault(uint64_t now)
+{
+    if (state != State::ONLINE)
+        return;
+
+    if (++failures < fault_threshold)
+        return;
+
+    printf("%s: ERROR - %d consecutive failures, start recovery\n", alias, failures);
+    down_since = now;
+    attempt = 0;
+    backoff_us = backoff_min_us;
+    deadline = now;
+    set_state(State::SOFT_RESET);
+}
+
+void recovery::rearm(uint64_t now)
+{
+    if (state != State::OFFLINE)
+        return;
+
+    attempt = 0;
+    backoff_us = backoff_min_us;
+    deadline = now;
+    set_state(State::SOFT_RESET);
+}
+
+void recovery::start(uint64_t now)
+{
+    starting = true;
+    failures = 0;
+    attempt = 0;
+    backoff_us = backoff_min_us;
+    down_since = now;
+    deadline = now;
+    set_state(State::SOFT_RESET);
+}
+
+uint64_t recovery::unavailable_us(uint64_t now) const
+{
+    if (state == State::ONLINE)
+        return 0;
+    return now - down_since;
+}
+
+void recovery::next_attempt(uint64_t now)
+{
+    if (++attempt >= max_retries)
+    {
+        printf("%s: ERROR - Recovery failed after %d attempts\n", alias, attempt);
+        // A failed bring-up is an outage from here on, rearm() recovers it like one
+        starting = false;
+        set_state(State::OFFLINE);
+        return;
+    }
+
+    deadline = now + backoff_us;
+    backoff_us = (backoff_us * 2 > backoff_max_us) ? backoff_max_us : backoff_us * 2;
+    set_state(State::BACKOFF);
+}
+
+recovery::State recovery::poll(uint64_t now)
+{
+    int ret;
+
+    if (now < deadline)
+        return state;
+
+    switch (state)
+    {
+    case State::ONLINE:
+    case State::OFFLINE:
+        break;
+
+    case State::SOFT_RESET:
+        ret = soft_reset ? soft_reset() : -1;
+        if (ret < 0)
+        {
+            printf("%s: ERROR - Soft reset\n", alias);
+            next_attempt(now);
+            break;
+        }
+        deadline = now + settle_us;
+        set_state(State::SETTLE);
+        break;
+
+    case State::GENERAL_CALL:
+        ret = i2c ? i2c->GeneralCallReset() : -1;
+        if (ret < 0)
+        {
+            printf("%s: ERROR - General call reset\n", alias);
+            next_attempt(now);
+            break;
+        }
+        deadline = now + settle_us;
+        set_state(State::SETTLE);
+        break;
+
+    case State::SETTLE:
+        ret = probe ? probe() : 0;
+        if (ret < 0)
+        {
+            next_attempt(now);
+            break;
+        }
+        failures = 0;
+        if (starting)
+        {
+            starting = false;
+            printf("%s: Started after %llu us\n", alias, (unsigned long long)(now - down_since));
+            set_state(State::ONLINE);
+            break;
+        }
+        last_outage_us = now - down_since;
+        downtime_us += last_outage_us;
+        outages++;
+        printf("%s: Recovered after %llu us\n", alias, (unsigned long long)last_outage_us);
+        set_state(State::ONLINE);
+        break;
+
+    case State::BACKOFF:
+        // Alternate device soft reset and bus wide general call reset
+        set_state((attempt % 2 == 0 || i2c == nullptr || starting) ? State::SOFT_RESET : State::GENERAL_CALL);
+        return poll(now);
+    }
+    return state;
+}
@@ -0,0 +1,127 @@
+/*
+ * File:     rt.cpp
+ * Notes:    Real-time acquisition setup and sampling jitter statistics
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "rt.hpp"
+#include <sched.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <math.h>
+#include <alloca.h>
+
+static void prefault_stack(size_t size)
+{
+    volatile char *stack = (volatile char *)alloca(size);
+    for (size_t i = 0; i < size; i += 4096)
+        stack[i] = 0;
+}
+
+int rt_setup(const rt_config &cfg)
+{
+    int ret = 0;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    {
+        printf("RT: ERROR - mlockall: %s\n", strerror(errno));
+        ret = -1;
+    }
+
+    // Freed memory stays mapped and locked, no page faults on reuse
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    prefault_stack(cfg.stack_prefault);
+
+    if (cfg.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg.cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err)
+        {
+            printf("RT: ERROR - Pin to CPU %d: %s\n", cfg.cpu, strerror(err));
+            ret = -1;
+        }
+    }
+
+    if (cfg.priority > 0)
+    {
+        struct sched_param param;
+        param.sched_priority = cfg.priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err)
+        {
+            printf("RT: ERROR - SCHED_FIFO priority %d: %s\n", cfg.priority, strerror(err));
+            ret = -1;
+        }
+    }
+
+    // Failed steps were reported above
+    if (ret == 0)
+        printf("RT: Memory locked, priority %d, CPU %d\n", cfg.priority, cfg.cpu);
+    return ret;
+}
+
+jitter_histogram::jitter_histogram(uint64_t period)
+    : period_us(period)
+{
+}
+
+void jitter_histogram::tick(uint64_t t)
+{
+    if (last)
+    {
+        int64_t dev = (int64_t)(t - last) - (int64_t)period_us;
+        uint64_t mag = dev < 0 ? -dev : dev;
+        int bin = 0;
+        while (mag && bin < JITTER_BINS - 1)
+        {
+            mag >>= 1;
+            bin++;
+        }
+        bins[bin]++;
+
+        if (count == 0 || dev < min)
+            min = dev;
+        if (count == 0 || dev > max)
+            max = dev;
+        sum += dev;
+        sum2 += (double)dev * dev;
+        count++;
+    }
+    last = t;
+}
+
+void jitter_histogram::report(const char *alias) const
+{
+    if (count == 0)
+        return;
+
+    double mean = sum / count;
+    double var = sum2 / count - mean * mean;
+    printf("%s: Period %llu us, %llu periods, jitter min %lld us, max %lld us, mean %.1f us, stddev %.1f us\n",
+           alias, (unsigned long long)period_us, (unsigned long long)count, (long long)min, (long long)max,
+           mean, var > 0 ? sqrt(var) : 0.0);
+
+    for (int k = 0; k < JITTER_BINS; k++)
+    {
+        if (bins[k] == 0)
+            continue;
+        uint64_t lo = k ? 1ull << (k - 1) : 0;
+        uint64_t hi = 1ull << k;
+        if (k == JITTER_BINS - 1)
+            printf("%s:  >= %8llu us %10llu\n", alias, (unsigned long long)lo, (unsigned long long)bins[k]);
+        else
+            printf("%s:  %8llu..%-8llu us %10llu\n", alias, (unsigned long long)lo, (unsigned long long)hi,
+                   (unsigned long long)bins[k]);
+    }
+}
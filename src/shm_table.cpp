@@ -0,0 +1,301 @@
+/*
+ * File:     shm_table.cpp
+ * Notes:    Shared memory latest-value table, publisher and reader
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "shm_table.hpp"
+#include "i_i2c.hpp"
+#include <sched.h>
+#include <sys/stat.h>
+
+#define LOAD(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+shm_publisher::shm_publisher(/* args */)
+{
+}
+
+shm_publisher::~shm_publisher()
+{
+    Close();
+}
+
+int shm_publisher::Open()
+{
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        printf("SHM: Can't open %s: %s\n", name.c_str(), strerror(errno));
+        return -1;
+    }
+
+    size = sizeof(shm_header) + slots * sizeof(shm_slot);
+    if (ftruncate(fd, size) < 0)
+    {
+        printf("SHM: Can't size %s: %s\n", name.c_str(), strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        printf("SHM: Can't map %s: %s\n", name.c_str(), strerror(errno));
+        return -1;
+    }
+
+    // A previous owner's table is reset, readers re-open on the epoch change
+    hdr = (shm_header *)map;
+    table = (shm_slot *)(hdr + 1);
+    STORE(hdr->magic, 0u);
+    memset(table, 0, slots * sizeof(shm_slot));
+    hdr->version = SHM_VERSION;
+    hdr->slots = slots;
+    hdr->used = 0;
+    hdr->seq = 0;
+    hdr->owner = getpid();
+    hdr->epoch++;
+    index.clear();
+    __atomic_store_n(&hdr->magic, (uint32_t)SHM_MAGIC, __ATOMIC_RELEASE);
+    printf("SHM: Publish %u slots in %s\n", slots, name.c_str());
+    return 0;
+}
+
+void shm_publisher::Close()
+{
+    if (hdr == nullptr)
+        return;
+
+    STORE(hdr->magic, 0u);
+    munmap(hdr, size);
+    shm_unlink(name.c_str());
+    hdr = nullptr;
+    table = nullptr;
+}
+
+shm_slot *shm_publisher::slot(uint32_t channel)
+{
+    auto it = index.find(channel);
+    if (it != index.end())
+        return &table[it->second];
+
+    uint32_t n = hdr->used;
+    if (n >= hdr->slots)
+        return nullptr;
+
+    // Fill the slot before it becomes visible through used
+    STORE(table[n].channel, channel);
+    index[channel] = n;
+    __atomic_store_n(&hdr->used, n + 1, __ATOMIC_RELEASE);
+    return &table[n];
+}
+
+void shm_publisher::write(shm_slot *sl, const sample &s)
+{
+    uint32_t seq = LOAD(sl->seq);
+    STORE(sl->seq, seq + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    STORE(sl->timestamp, s.timestamp);
+    STORE(sl->value, s.value);
+    STORE(sl->updates, LOAD(sl->updates) + 1);
+    __atomic_store_n(&sl->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int shm_publisher::publish(const sample &s)
+{
+    return publish(&s, 1) == 1 ? 0 : -1;
+}
+
+size_t shm_publisher::publish(const sample *s, size_t n)
+{
+    size_t done = 0;
+    if (hdr == nullptr)
+        return 0;
+
+    uint32_t seq = LOAD(hdr->seq);
+    STORE(hdr->seq, seq + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < n; i++)
+    {
+        shm_slot *sl = slot(s[i].channel);
+        if (sl == nullptr)
+            continue;
+        write(sl, s[i]);
+        done++;
+    }
+    __atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+    return done;
+}
+
+shm_reader::shm_reader(/* args */)
+{
+}
+
+shm_reader::~shm_reader()
+{
+    Close();
+}
+
+int shm_reader::Open()
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_header))
+    {
+        close(fd);
+        return -1;
+    }
+
+    size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    hdr = (const shm_header *)map;
+    table = (const shm_slot *)(hdr + 1);
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC || hdr->version != SHM_VERSION ||
+        sizeof(shm_header) + hdr->slots * sizeof(shm_slot) > size)
+    {
+        Close();
+        return -1;
+    }
+    owner = hdr->owner;
+    epoch = hdr->epoch;
+
+    // Twice the slots, probes stay short, sized once per mapping
+    uint32_t n = 2;
+    while (n < 2 * hdr->slots)
+        n <<= 1;
+    lookup.assign(n, 0);
+    mask = n - 1;
+    indexed = 0;
+    return 0;
+}
+
+void shm_reader::Close()
+{
+    if (hdr == nullptr)
+        return;
+    munmap((void *)hdr, size);
+    hdr = nullptr;
+    table = nullptr;
+}
+
+bool shm_reader::owned() const
+{
+    return hdr && __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC && LOAD(hdr->owner) == owner &&
+           LOAD(hdr->epoch) == epoch;
+}
+
+bool shm_reader::current()
+{
+    if (owned())
+        return true;
+
+    // Closed: magic cleared and unlinked. Restarted: reset in place by a
+    // new owner. Either way the mapping is of no use anymore.
+    Close();
+    return Open() == 0;
+}
+
+static uint32_t hash(uint32_t channel, uint32_t mask)
+{
+    return (channel * 2654435761u) & mask;
+}
+
+void shm_reader::reindex()
+{
+    // Slots never move, index only the ones added since last time
+    uint32_t used = __atomic_load_n(&hdr->used, __ATOMIC_ACQUIRE);
+    if (used > hdr->slots)
+        return;
+    for (; indexed < used; indexed++)
+    {
+        uint32_t h = hash(LOAD(table[indexed].channel), mask);
+        while (lookup[h])
+            h = (h + 1) & mask;
+        lookup[h] = indexed + 1;
+    }
+}
+
+const shm_slot *shm_reader::find(uint32_t channel) const
+{
+    for (uint32_t h = hash(channel, mask); lookup[h]; h = (h + 1) & mask)
+        if (LOAD(table[lookup[h] - 1].channel) == channel)
+            return &table[lookup[h] - 1];
+    return nullptr;
+}
+
+bool shm_reader::backoff(uint32_t &tries) const
+{
+    // A publisher preempted mid-write gets the CPU back, one that died
+    // mid-write leaves seq odd for good and the read gives up
+    if (++tries >= SHM_RETRIES || not owned())
+        return false;
+    if (tries % SHM_SPINS == 0)
+        sched_yield();
+    return true;
+}
+
+bool shm_reader::read(const shm_slot *sl, sample &s)
+{
+    uint32_t seq1, seq2, tries = 0;
+    do
+    {
+        seq1 = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE);
+        s.timestamp = LOAD(sl->timestamp);
+        s.value = LOAD(sl->value);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = LOAD(sl->seq);
+    } while (((seq1 & 1) || seq1 != seq2) && backoff(tries));
+    s.channel = sl->channel;
+    return not (seq1 & 1) && seq1 == seq2;
+}
+
+bool shm_reader::get(uint32_t channel, sample &s)
+{
+    if (not current())
+        return false;
+
+    reindex();
+    const shm_slot *sl = find(channel);
+    if (sl == nullptr || not read(sl, s))
+        return false;
+
+    // A reset during the read may have torn it
+    return owned() && s.timestamp != 0;
+}
+
+size_t shm_reader::snapshot(sample *out, size_t max)
+{
+    if (not current())
+        return 0;
+
+    uint32_t seq1, seq2, used, tries = 0;
+    do
+    {
+        seq1 = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+        used = __atomic_load_n(&hdr->used, __ATOMIC_ACQUIRE);
+        used = used < max ? used : max;
+        for (uint32_t i = 0; i < used; i++)
+        {
+            out[i].channel = LOAD(table[i].channel);
+            out[i].timestamp = LOAD(table[i].timestamp);
+            out[i].value = LOAD(table[i].value);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = LOAD(hdr->seq);
+    } while (((seq1 & 1) || seq1 != seq2) && backoff(tries));
+    if ((seq1 & 1) || seq1 != seq2)
+        return 0;
+    return owned() ? used : 0;
+}
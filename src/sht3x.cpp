@@ -8,9 +8,12 @@
  */
 
 #include "sht3x.hpp"
+#include "clock.hpp"
+#include "record.hpp"
 
 sht3x::sht3x(/* args */)
 {
+    results.fetch = [this](raw_result &r) { return get_data(r.raw); };
 }
 
 sht3x::~sht3x()
@@ -25,16 +28,24 @@ void sht3x::init()
 }
 
 void sht3x::reset()
+{
+    soft_reset();
+    // 1.5 ms - max time between ACK of soft reset command and sensor entering idle state
+    clk()->sleep_us(RESET_DURATION_US);
+}
+
+int sht3x::soft_reset()
 {
     printf("SHT3X: Reset device\n");
     int ret = i2c->Write<uint16_t>(RESET_CMD);
-    if(ret<0)
+    if (ret < 0)
         printf("SHT3X: ERROR - Reset device\n");
-    // 0.5 ms - time between ACK of soft reset command and sensor entering idle state
-    usleep(500 * 1000);
+    started = false;
+    results.invalidate();
+    return ret;
 }
 
-void sht3x::get_status()
+int sht3x::get_status()
 {
     printf("SHT3X: Get status\n");
     int ret;
@@ -42,12 +53,19 @@ void sht3x::get_status()
     uint8_t buffer[size] = {0};
     ret = i2c->Read<uint16_t>(STATUS_CMD, buffer, size);
     if (ret < 0)
+    {
         printf("SHT3X: ERROR - failed read status\n");
+        return ret;
+    }
 
     if (crc8(buffer, 2) != buffer[2])
+    {
         printf("SHT3X: ERROR - checksum failed\n");
+        return -1;
+    }
     uint16_t status = buffer[0] << 8 | buffer[1];
     printf("SHT3X: Status: 0x%hx\n", status);
+    return ret;
 }
 
 void sht3x::clear_status()
@@ -72,6 +90,8 @@ int sht3x::start(Frequency frq, Repeatability rept)
     }
     mode = frq;
     started = true;
+    // A result of the previous mode must not be served for the new one
+    results.invalidate();
     return ret;
 }
 
@@ -85,6 +105,7 @@ int sht3x::stop()
         return ret;
     }
     started = false;
+    results.invalidate();
     return ret;
 }
 
@@ -94,14 +115,14 @@ int sht3x::single(float* temperature, float* humidity)
     if (start(Frequency::SINGLE_SHOT, Repeatability::HIGH) < 0)
         return -1;
 
-    usleep(MEAS_DURATION_US[(uint8_t)Repeatability::HIGH]);
+    clk()->sleep_us(MEAS_DURATION_US[(uint8_t)Repeatability::HIGH]);
 
     return get_results (temperature, humidity);
 }
 
 void sht3x::sleep (Repeatability rept)
 {
-    usleep(MEAS_DURATION_US[(uint8_t)rept]);
+    clk()->sleep_us(MEAS_DURATION_US[(uint8_t)rept]);
 }
 
 int sht3x::get_results (float* temperature, float* humidity)
@@ -114,6 +135,16 @@ int sht3x::get_results (float* temperature, float* humidity)
     return 0;
 }
 
+int sht3x::get_results(float *temperature, float *humidity, uint64_t max_age_us)
+{
+    raw_result r;
+    if (results.get(max_age_us, r) < 0)
+        return -1;
+
+    parse_data(r.raw, temperature, humidity);
+    return 0;
+}
+
 int sht3x::get_data(raw_data_t raw_data)
 {
     printf("SHT3X: Get measurement\n");
@@ -127,6 +158,25 @@ int sht3x::get_data(raw_data_t raw_data)
     if (mode == Frequency::SINGLE_SHOT)
         started = false;
 
+    return check_data(raw_data) < 0 ? -1 : ret;
+}
+
+int sht3x::read_single(raw_data_t raw_data)
+{
+    struct i2c_msg msg;
+
+    msg.addr = i2c->address;
+    msg.flags = I2C_M_RD;
+    msg.len = RAW_DATA_SIZE;
+    msg.buf = raw_data;
+    if (i2c->Transfer(&msg, 1) < 0)
+        return -1;
+
+    return check_data(raw_data);
+}
+
+int sht3x::check_data(raw_data_t raw_data)
+{
     // check temperature crc
     if (crc8(raw_data, 2) != raw_data[2])
     {
@@ -141,17 +191,105 @@ int sht3x::get_data(raw_data_t raw_data)
         return -1;
     }
 
+    return 0;
+}
+
+Status sht3x::trigger()
+{
+    if (started && mode != Frequency::SINGLE_SHOT)
+        return Status::OK;
+    if (i2c->Write<uint16_t>(single_cmd(single_rept)) < 0)
+        return Status::IO;
+    mode = Frequency::SINGLE_SHOT;
+    started = true;
+    return Status::OK;
+}
+
+uint32_t sht3x::ready_us() const
+{
+    return started && mode != Frequency::SINGLE_SHOT ? 0 : duration_us(single_rept);
+}
+
+Status sht3x::fetch()
+{
+    if (not started)
+        return Status::STATE;
+
+    int ret;
+    if (mode == Frequency::SINGLE_SHOT)
+    {
+        struct i2c_msg msg = {i2c->address, I2C_M_RD, RAW_DATA_SIZE, result};
+        ret = i2c->Transfer(&msg, 1);
+        started = false;
+    }
+    else
+        ret = i2c->Read<uint16_t>(FETCH_DATA_CMD, result, RAW_DATA_SIZE);
+    if (ret < 0)
+        return Status::IO;
+
+    if (crc8(result, 2) != result[2] || crc8(result + 3, 2) != result[5])
+        return Status::CRC;
+    return Status::OK;
+}
+
+size_t sht3x::decode(uint64_t ts, sample *out, size_t max) const
+{
+    if (max < SENSOR_SAMPLES)
+        return 0;
+    out[0] = {ts, make_channel(i2c->node(), Kind::SHT3X_T), result[0] << 8 | result[1]};
+    out[1] = {ts, make_channel(i2c->node(), Kind::SHT3X_RH), result[3] << 8 | result[4]};
+    return SENSOR_SAMPLES;
+}
+
+int sht3x::set_alert_limit(AlertLimit which, float temperature, float humidity)
+{
+    // Clamp to the code range before rounding to the limit format
+    temperature = temperature < -45.0f ? -45.0f : temperature > 130.0f ? 130.0f : temperature;
+    humidity = humidity < 0.0f ? 0.0f : humidity > 100.0f ? 100.0f : humidity;
+    uint16_t word = alert_word(record<Kind::SHT3X_T>::of(temperature).code,
+                               record<Kind::SHT3X_RH>::of(humidity).code);
+    uint8_t buf[3] = {(uint8_t)(word >> 8), (uint8_t)(word & 0xFF)};
+    buf[2] = crc8(buf, 2);
+
+    int ret = i2c->Write<uint16_t>(ALERT_WRITE_CMD[(uint8_t)which], buf, sizeof(buf));
+    if (ret < 0)
+    {
+        printf("SHT3X: ERROR - failed to write alert limit\n");
+        return ret;
+    }
+    printf("SHT3X: Alert limit %d: %.1f °C, %.1f %%\n", (int)which, temperature, humidity);
+    return ret;
+}
+
+int sht3x::get_alert_limit(AlertLimit which, float *temperature, float *humidity)
+{
+    uint8_t buf[3];
+
+    int ret = i2c->Read<uint16_t>(ALERT_READ_CMD[(uint8_t)which], buf, sizeof(buf));
+    if (ret < 0)
+    {
+        printf("SHT3X: ERROR - failed to read alert limit\n");
+        return ret;
+    }
+    if (crc8(buf, 2) != buf[2])
+    {
+        printf("SHT3X: ERROR - checksum failed\n");
+        return -1;
+    }
+    uint16_t word = buf[0] << 8 | buf[1];
+    *temperature = record<Kind::SHT3X_T>{(uint16_t)(word << 7)}.value();
+    *humidity = record<Kind::SHT3X_RH>{(uint16_t)(word & 0xFE00)}.value();
     return ret;
 }
 
 void sht3x::parse_data(raw_data_t raw_data, float *temperature, float *humidity)
 {
     printf("SHT3X: Parsing raw data\n");
-    *temperature = ((((raw_data[0] * 256.0) + raw_data[1]) * 175) / 65535.0) - 45;
-    *humidity = ((((raw_data[3] * 256.0) + raw_data[4]) * 100) / 65535.0);
+    *temperature = record<Kind::SHT3X_T>{(uint16_t)(raw_data[0] << 8 | raw_data[1])}.value();
+    *humidity = record<Kind::SHT3X_RH>{(uint16_t)(raw_data[3] << 8 | raw_data[4])}.value();
 }
 
-uint8_t sht3x::crc8(uint8_t *arr, int size)
+uint8_t sht3x::crc8(const uint8_t *arr, int size)
 {
     uint8_t crc = 0xff;
     for (int i = 0; i < size; i++)
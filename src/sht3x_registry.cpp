@@ -0,0 +1,218 @@
+/*
+ * File:     sht3x_registry.cpp
+ * Notes:    Structure-of-arrays registry for large SHT3x fleets
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "sht3x_registry.hpp"
+#include "clock.hpp"
+#include <stdio.h>
+
+// Periodic mode interval per Frequency [us]
+static constexpr uint32_t PERIOD_US[6] = {0, 2000000, 1000000, 500000, 250000, 100000};
+
+sht3x_registry::sht3x_registry(/* args */)
+{
+}
+
+sht3x_registry::~sht3x_registry()
+{
+}
+
+size_t sht3x_registry::add(uint8_t b, uint8_t addr)
+{
+    bus.push_back(b);
+    address.push_back(addr);
+    mode.push_back(Frequency::SINGLE_SHOT);
+    rept.push_back(Repeatability::HIGH);
+    deadline.push_back(REGISTRY_IDLE);
+    period_us.push_back(0);
+    errors.push_back(0);
+    failures.push_back(0);
+    t_code.push_back(0);
+    rh_code.push_back(0);
+    return address.size() - 1;
+}
+
+int sht3x_registry::command(size_t i, uint16_t cmd)
+{
+    struct i2c_msg msg;
+    uint8_t buf[2] = {(uint8_t)(cmd >> 8), (uint8_t)(cmd & 0xFF)};
+
+    msg.addr = address[i];
+    msg.flags = 0;
+    msg.len = 2;
+    msg.buf = buf;
+    if (buses[bus[i]]->Transfer(&msg, 1) < 0)
+    {
+        errors[i]++;
+        failures[i]++;
+        return -1;
+    }
+    return 0;
+}
+
+size_t sht3x_registry::start(Frequency frq, Repeatability rpt)
+{
+    uint16_t cmd = sht3x::measure_cmd(frq, rpt);
+    size_t failed = 0;
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        if (command(i, cmd) < 0)
+        {
+            deadline[i] = REGISTRY_IDLE;
+            failed++;
+            continue;
+        }
+        mode[i] = frq;
+        rept[i] = rpt;
+        period_us[i] = PERIOD_US[(uint8_t)frq];
+        deadline[i] = 0;
+    }
+
+    // Same deadline for the whole fleet, results are collected in batches
+    uint64_t ready = clk()->now_us() + sht3x::duration_us(rpt);
+    for (size_t i = 0; i < size(); i++)
+        if (deadline[i] == 0)
+            deadline[i] = ready;
+    if (failed)
+        printf("REGISTRY: ERROR - Start failed on %zu of %zu devices\n", failed, size());
+    return failed;
+}
+
+size_t sht3x_registry::stop()
+{
+    size_t failed = 0;
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        if (mode[i] == Frequency::SINGLE_SHOT)
+            continue;
+        failed += command(i, BREAK_CMD) < 0;
+        mode[i] = Frequency::SINGLE_SHOT;
+        deadline[i] = REGISTRY_IDLE;
+    }
+    return failed;
+}
+
+size_t sht3x_registry::soft_reset()
+{
+    size_t failed = 0;
+
+    for (size_t i = 0; i < size(); i++)
+    {
+        failed += command(i, RESET_CMD) < 0;
+        mode[i] = Frequency::SINGLE_SHOT;
+        deadline[i] = REGISTRY_IDLE;
+    }
+    return failed;
+}
+
+uint64_t sht3x_registry::next_deadline() const
+{
+    uint64_t next = REGISTRY_IDLE;
+    for (uint64_t d : deadline)
+        next = d < next ? d : next;
+    return next;
+}
+
+int sht3x_registry::fetch(uint8_t b, const size_t *idx, size_t n, uint8_t (*raw)[RAW_DATA_SIZE])
+{
+    struct i2c_msg msgs[2 * REGISTRY_BATCH];
+    uint8_t fetch_cmd[2] = {FETCH_DATA_CMD >> 8, FETCH_DATA_CMD & 0xFF};
+    uint32_t m = 0;
+
+    for (size_t j = 0; j < n; j++)
+    {
+        size_t i = idx[j];
+        // Single shot results are read without a command
+        if (mode[i] != Frequency::SINGLE_SHOT)
+            msgs[m++] = {address[i], 0, 2, fetch_cmd};
+        msgs[m++] = {address[i], I2C_M_RD, RAW_DATA_SIZE, raw[j]};
+    }
+    return buses[b]->Transfer(msgs, m);
+}
+
+void sht3x_registry::advance(size_t i, uint64_t now)
+{
+    if (period_us[i] == 0)
+    {
+        deadline[i] = REGISTRY_IDLE;
+        return;
+    }
+    // Skip results missed while the poll was late
+    deadline[i] += period_us[i];
+    if (deadline[i] <= now)
+        deadline[i] = now + period_us[i];
+}
+
+size_t sht3x_registry::flush(uint8_t b, uint64_t now, uint64_t ts, sample *out)
+{
+    uint8_t raw[REGISTRY_BATCH][RAW_DATA_SIZE];
+    const size_t *idx = &pending[b * REGISTRY_BATCH];
+    size_t n = npending[b];
+    uint16_t base = buses[b]->node() & ~0x7F; // mux part of the node
+    size_t k = 0;
+
+    npending[b] = 0;
+    if (n == 0)
+        return 0;
+
+    // One transaction for the batch, on failure find the device
+    bool batch_ok = fetch(b, idx, n, raw) >= 0;
+    for (size_t j = 0; j < n; j++)
+    {
+        size_t i = idx[j];
+        bool ok = batch_ok || fetch(b, &idx[j], 1, &raw[j]) >= 0;
+        ok = ok && sht3x::crc8(raw[j], 2) == raw[j][2] && sht3x::crc8(raw[j] + 3, 2) == raw[j][5];
+        advance(i, now);
+        if (not ok)
+        {
+            errors[i]++;
+            failures[i]++;
+            continue;
+        }
+        errors[i] = 0;
+        t_code[i] = raw[j][0] << 8 | raw[j][1];
+        rh_code[i] = raw[j][3] << 8 | raw[j][4];
+        uint16_t node = base | address[i];
+        out[k++] = {ts, make_channel(node, Kind::SHT3X_T), t_code[i]};
+        out[k++] = {ts, make_channel(node, Kind::SHT3X_RH), rh_code[i]};
+    }
+    return k;
+}
+
+size_t sht3x_registry::poll(uint64_t now, sample *out, size_t max)
+{
+    uint64_t ts = sample_time();
+    size_t k = 0, queued = 0;
+
+    pending.resize(buses.size() * REGISTRY_BATCH);
+    npending.assign(buses.size(), 0);
+
+    // Only the deadline column is scanned for devices that are not due
+    for (size_t i = 0; i < size(); i++)
+    {
+        if (deadline[i] > now)
+            continue;
+        if (k + 2 * (queued + 1) > max)
+            break;
+
+        uint8_t b = bus[i];
+        pending[b * REGISTRY_BATCH + npending[b]++] = i;
+        queued++;
+        if (npending[b] == REGISTRY_BATCH)
+        {
+            queued -= REGISTRY_BATCH;
+            k += flush(b, now, ts, out + k);
+        }
+    }
+
+    for (size_t b = 0; b < buses.size(); b++)
+        k += flush(b, now, ts, out + k);
+    return k;
+}
@@ -0,0 +1,607 @@
+/*
+ * File:     sim_bus.cpp
+ * Notes:    Simulated I2C bus with SHT3x, MS5607 and PAC193x models
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "sim_bus.hpp"
+#include "ms5607.hpp"
+#include <math.h>
+
+#define DAY_US (86400.0 * 1000000)
+
+static uint8_t sht3x_crc(const uint8_t *buf, int size)
+{
+    uint8_t crc = 0xff;
+    for (int i = 0; i < size; i++)
+    {
+        crc ^= buf[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+    }
+    return crc;
+}
+
+// Alert limit commands, AlertLimit order
+static const uint16_t LIMIT_WRITE[4] = {0x611D, 0x6116, 0x610B, 0x6100};
+static const uint16_t LIMIT_READ[4] = {0xE11F, 0xE114, 0xE109, 0xE102};
+
+sim_sht3x::sim_sht3x(uint8_t addr)
+{
+    address = addr;
+}
+
+// Temperature and humidity codes at t, n is the noise in [-0.5, 0.5)
+static void sht3x_codes(uint64_t t, double n, uint16_t &st, uint16_t &srh)
+{
+    double phase = 2 * M_PI * t / DAY_US;
+    double temperature = 22.0 + 3.0 * sin(phase) + 0.02 * n;
+    double humidity = 45.0 + 10.0 * cos(phase) + 0.1 * n;
+    st = (uint16_t)((temperature + 45.0) * 65535.0 / 175.0);
+    srh = (uint16_t)(humidity * 65535.0 / 100.0);
+}
+
+void sim_sht3x::measurement(uint8_t *buf, uint64_t t)
+{
+    uint16_t st, srh;
+
+    // xorshift noise, deterministic
+    noise ^= noise << 13;
+    noise ^= noise >> 17;
+    noise ^= noise << 5;
+    sht3x_codes(t, (double)(noise % 1000) / 1000.0 - 0.5, st, srh);
+
+    buf[0] = st >> 8;
+    buf[1] = st & 0xFF;
+    buf[2] = sht3x_crc(buf, 2);
+    buf[3] = srh >> 8;
+    buf[4] = srh & 0xFF;
+    buf[5] = sht3x_crc(buf + 3, 2);
+}
+
+int sim_sht3x::write(const uint8_t *buf, uint16_t len)
+{
+    if (len < 2)
+        return -1;
+
+    uint64_t now = clk()->now_us();
+    cmd = buf[0] << 8 | buf[1];
+    uint8_t msb = buf[0];
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (cmd == LIMIT_READ[i])
+            return 0;
+        if (cmd != LIMIT_WRITE[i])
+            continue;
+        if (len != 5 || sht3x_crc(buf + 2, 2) != buf[4])
+            return -1;
+        limit[i] = buf[2] << 8 | buf[3];
+        return 0;
+    }
+
+    switch (cmd)
+    {
+    case 0x30A2: // soft reset
+        periodic = false;
+        single_ready = 0;
+        status = 0x0010;
+        return 0;
+    case 0xF32D: // status
+    case 0xE000: // fetch
+        return 0;
+    case 0x3041: // clear status
+        status &= ~0x8C13;
+        return 0;
+    case 0x3093: // break
+        periodic = false;
+        return 0;
+    case 0x3066: // heater off
+        return 0;
+    }
+
+    if (msb == 0x24) // single shot, no clock stretching
+    {
+        if (periodic)
+            return -1;
+        single_ready = now + 15000;
+        return 0;
+    }
+
+    static const struct
+    {
+        uint8_t msb;
+        uint32_t period_us;
+    } rates[] = {{0x20, 2000000}, {0x21, 1000000}, {0x22, 500000}, {0x23, 250000}, {0x27, 100000}};
+    for (auto &r : rates)
+    {
+        if (msb == r.msb)
+        {
+            periodic = true;
+            period_us = r.period_us;
+            period_start = now;
+            fetched = 0;
+            return 0;
+        }
+    }
+    return -1; // unknown command
+}
+
+int sim_sht3x::read(uint8_t *buf, uint16_t len)
+{
+    uint64_t now = clk()->now_us();
+
+    if (cmd == 0xF32D)
+    {
+        if (len < 3)
+            return -1;
+        buf[0] = status >> 8;
+        buf[1] = status & 0xFF;
+        buf[2] = sht3x_crc(buf, 2);
+        return 0;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (cmd != LIMIT_READ[i])
+            continue;
+        if (len < 3)
+            return -1;
+        buf[0] = limit[i] >> 8;
+        buf[1] = limit[i] & 0xFF;
+        buf[2] = sht3x_crc(buf, 2);
+        return 0;
+    }
+
+    if (len < 6)
+        return -1;
+
+    if (single_ready && now >= single_ready)
+    {
+        measurement(buf, single_ready);
+        single_ready = 0;
+        return 0;
+    }
+
+    if (periodic && cmd == 0xE000 && now >= period_start + 15000)
+    {
+        uint64_t available = (now - period_start - 15000) / period_us + 1;
+        if (available > fetched)
+        {
+            fetched = available;
+            measurement(buf, period_start + (available - 1) * period_us + 15000);
+            return 0;
+        }
+    }
+    return -1; // no data, NACK
+}
+
+void sim_sht3x::general_call(const uint8_t *buf, uint16_t len)
+{
+    if (len >= 1 && buf[0] == 0x06)
+    {
+        periodic = false;
+        single_ready = 0;
+        status = 0x0010;
+    }
+}
+
+bool sim_sht3x::alert_level(uint64_t t, bool state) const
+{
+    uint16_t st, srh;
+
+    // Upper 9 bits of temperature, upper 7 bits of humidity, as the limits
+    sht3x_codes(t, 0, st, srh);
+    uint16_t tc = st >> 7, rc = srh >> 9;
+    auto above = [&](uint16_t w) { return tc > (w & 0x1FF) || rc > (w >> 9); };
+    auto below = [&](uint16_t w) { return tc < (w & 0x1FF) || rc < (w >> 9); };
+
+    if (above(limit[0]) || below(limit[3]))
+        return true;
+    if (not above(limit[1]) && not below(limit[2]))
+        return false;
+    return state; // between set and clear limits
+}
+
+uint64_t sim_sht3x::next_measurement(uint64_t t) const
+{
+    uint64_t first = period_start + 15000;
+    return t < first ? first : first + ((t - first) / period_us + 1) * period_us;
+}
+
+uint64_t sim_sht3x::next_edge(uint64_t after, uint64_t until, bool &rising)
+{
+    if (not periodic)
+        return UINT64_MAX;
+
+    // Pin state up to after is final. Edges passed while nobody waited
+    // are reported late, as a GPIO line queues them.
+    for (uint64_t t = next_measurement(alert_at); t <= after; t = next_measurement(t))
+    {
+        bool level = alert_level(t, alert);
+        alert_at = t;
+        if (level == alert)
+            continue;
+        alert = level;
+        if (t != edge_at)
+        {
+            edge_at = t;
+            rising = level;
+            return t;
+        }
+    }
+
+    for (uint64_t t = next_measurement(after); t <= until; t = next_measurement(t))
+    {
+        if (alert_level(t, alert) != alert)
+        {
+            rising = not alert;
+            edge_at = t;
+            return t;
+        }
+    }
+    return UINT64_MAX;
+}
+
+sim_ms5607::sim_ms5607(uint8_t addr)
+{
+    // Coefficients of the datasheet example, D1 = 6465444 and D2 = 8077636
+    // give 20.07 °C and 1000.09 mbar
+    static const uint16_t coef[8] = {0x0000, 46372, 43981, 29059, 27842, 31553, 28165, 0x0000};
+    address = addr;
+    memcpy(prom, coef, sizeof(prom));
+    prom[7] |= ms5607::crc4(prom);
+}
+
+int sim_ms5607::write(const uint8_t *buf, uint16_t len)
+{
+    static const uint32_t conv_us[5] = {600, 1170, 2280, 4540, 9040};
+    uint64_t now = clk()->now_us();
+
+    if (len < 1)
+        return -1;
+    cmd = buf[0];
+
+    if (cmd == 0x1E || cmd == 0x00 || (cmd >= 0xA0 && cmd <= 0xAE && !(cmd & 1)))
+        return 0;
+
+    if ((cmd & 0xE0) != 0x40 || (cmd & 0x0F) > 8 || (cmd & 1))
+        return -1;
+
+    // Datasheet RMS noise of the pressure per OSR [mbar]
+    static const double p_noise[5] = {0.13, 0.084, 0.054, 0.036, 0.024};
+    noise ^= noise << 13;
+    noise ^= noise >> 17;
+    noise ^= noise << 5;
+    double n = ((double)(noise % 1000) / 1000.0 - 0.5) * 3.4641; // uniform, unit variance
+
+    // Conversion D1 (0x4x) or D2 (0x5x), value fixed at start
+    double t = (double)clk()->now_us();
+    double temperature = 21.0 + 2.0 * sin(2 * M_PI * t / DAY_US);
+    double pressure = 1013.25 + 1.5 * sin(2 * M_PI * t / (DAY_US / 8)) + p_noise[(cmd & 0x0F) / 2] * n; // [mbar]
+    double dT = (temperature * 100 - 2000) * 8388608.0 / prom[6];
+    double off = prom[2] * 131072.0 + prom[4] * dT / 64;
+    double sens = prom[1] * 65536.0 + prom[3] * dT / 128;
+    double value = (cmd & 0x10) ? prom[5] * 256.0 + dT
+                                : (pressure * 100 * 32768.0 + off) * 2097152.0 / sens;
+    conv_value = value < 0 ? 0 : value > 0xFFFFFF ? 0xFFFFFF : (uint32_t)value;
+    conv_done = now + conv_us[(cmd & 0x0F) / 2];
+    return 0;
+}
+
+int sim_ms5607::read(uint8_t *buf, uint16_t len)
+{
+    if (cmd >= 0xA0 && cmd <= 0xAE)
+    {
+        if (len < 2)
+            return -1;
+        uint16_t word = prom[(cmd - 0xA0) / 2];
+        buf[0] = word >> 8;
+        buf[1] = word & 0xFF;
+        return 0;
+    }
+
+    if (cmd == 0x00)
+    {
+        if (len < 3)
+            return -1;
+        // Result is read once, an early read returns 0
+        uint32_t value = 0;
+        if (conv_done && clk()->now_us() >= conv_done)
+        {
+            value = conv_value;
+            conv_done = 0;
+        }
+        buf[0] = value >> 16;
+        buf[1] = value >> 8;
+        buf[2] = value;
+        return 0;
+    }
+    return -1;
+}
+
+// PAC193x register widths [bytes]
+static uint8_t pac_width(uint8_t reg)
+{
+    if (reg == 0x02)
+        return 3;
+    if (reg >= 0x03 && reg <= 0x06)
+        return 6;
+    if (reg >= 0x07 && reg <= 0x16)
+        return 2;
+    if (reg >= 0x17 && reg <= 0x1A)
+        return 4;
+    if (reg == 0x00 || reg == 0x1E || reg == 0x1F)
+        return 0;
+    return 1;
+}
+
+sim_pac193x::sim_pac193x(uint8_t addr, uint8_t product_id)
+{
+    address = addr;
+    regs[0xFD] = product_id;
+    reset();
+}
+
+void sim_pac193x::reset()
+{
+    uint8_t pid = regs[0xFD];
+    memset(regs, 0, sizeof(regs));
+    memset(wide, 0, sizeof(wide));
+    regs[0x01] = 0x00; // CTRL, 1024 sps
+    regs[0xFD] = pid;
+    regs[0xFE] = 0x5D; // manufacturer
+    regs[0xFF] = 0x03; // revision
+    conv_start = clk()->now_us();
+}
+
+uint64_t sim_pac193x::next_edge(uint64_t after, uint64_t until, bool &rising)
+{
+    static const double sps[4] = {1024, 256, 64, 8};
+    uint8_t ctrl = regs[0x01];
+
+    if (not(ctrl & 0x08) || not(ctrl & 0x04) || after < conv_start)
+        return UINT64_MAX;
+
+    // End of the first conversion cycle after after, pulse low
+    double period = 1000000.0 / sps[ctrl >> 6];
+    uint64_t k = (uint64_t)((after - conv_start) / period) + 1;
+    uint64_t t = conv_start + (uint64_t)ceil(k * period);
+    if (t <= after)
+        t = conv_start + (uint64_t)ceil(++k * period);
+    if (t > until)
+        return UINT64_MAX;
+    rising = false;
+    return t;
+}
+
+void sim_pac193x::refresh()
+{
+    static const double volts[4] = {12.0, 5.0, 3.3, 1.8};
+    static const double amps[4] = {0.5, 1.2, 0.3, 0.1};
+    double t = clk()->now_us() / 1000000.0;
+    int channels = regs[0xFD] - 0x58 + 1;
+
+    for (int ch = 0; ch < 4; ch++)
+    {
+        double v = ch < channels ? volts[ch] * (1 + 0.001 * sin(2 * M_PI * t / 0.7 + ch)) : 0;
+        double i = ch < channels ? amps[ch] * (1 + 0.2 * sin(2 * M_PI * t / 10 + ch)) : 0;
+        uint16_t vbus = (uint16_t)(v / 32.0 * 65536.0);
+        uint16_t vsense = (uint16_t)(i * 0.010 / 0.1 * 65536.0); // 10 mOhm, 100 mV FSR
+        uint8_t *p;
+
+        for (uint8_t reg : {(uint8_t)(0x07 + ch), (uint8_t)(0x0F + ch)})
+        {
+            p = wide[reg];
+            p[0] = vbus >> 8;
+            p[1] = vbus & 0xFF;
+        }
+        for (uint8_t reg : {(uint8_t)(0x0B + ch), (uint8_t)(0x13 + ch)})
+        {
+            p = wide[reg];
+            p[0] = vsense >> 8;
+            p[1] = vsense & 0xFF;
+        }
+        uint32_t power = ((uint32_t)vbus * vsense) >> 4;
+        p = wide[0x17 + ch];
+        p[0] = power >> 24;
+        p[1] = power >> 16;
+        p[2] = power >> 8;
+        p[3] = power;
+    }
+}
+
+int sim_pac193x::write(const uint8_t *buf, uint16_t len)
+{
+    if (len < 1)
+        return -1;
+
+    pointer = buf[0];
+    if (len == 1)
+    {
+        if (pointer == 0x00 || pointer == 0x1E || pointer == 0x1F)
+            refresh();
+        return 0;
+    }
+
+    // Single byte registers are writable
+    for (uint16_t i = 1; i < len; i++)
+        regs[(uint8_t)(pointer + i - 1)] = buf[i];
+    if (pointer == 0x01) // CTRL, the sample rate may have changed
+        conv_start = clk()->now_us();
+    return 0;
+}
+
+int sim_pac193x::read(uint8_t *buf, uint16_t len)
+{
+    uint8_t reg = pointer;
+    uint16_t done = 0;
+
+    int channels = regs[0xFD] - 0x58 + 1;
+
+    // Auto increment over registers of different widths, registers of
+    // channels the variant doesn't have are skipped like on the device
+    while (done < len)
+    {
+        if (reg != pointer && reg >= 0x03 && reg <= 0x1A && (reg - 0x03) % 4 >= channels)
+        {
+            reg++;
+            continue;
+        }
+        uint8_t width = pac_width(reg);
+        if (width == 1)
+            buf[done++] = regs[reg];
+        for (uint8_t i = 0; width > 1 && i < width && done < len; i++)
+            buf[done++] = wide[reg][i];
+        reg++;
+    }
+    return 0;
+}
+
+void sim_pac193x::general_call(const uint8_t *buf, uint16_t len)
+{
+    if (len < 1)
+        return;
+    if (buf[0] == 0x1E) // REFRESH_G
+        refresh();
+    else if (buf[0] == 0x06)
+        reset();
+}
+
+sim_tca9548a::sim_tca9548a(uint8_t addr)
+{
+    address = addr;
+}
+
+int sim_tca9548a::write(const uint8_t *buf, uint16_t len)
+{
+    if (len != 1)
+        return -1;
+    control = buf[0];
+    return 0;
+}
+
+int sim_tca9548a::read(uint8_t *buf, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+        buf[i] = control;
+    return 0;
+}
+
+void sim_events::add(uint32_t line, sim_device *dev)
+{
+    lines.push_back({line, dev});
+}
+
+int sim_events::wait(line_event *ev, int max, uint64_t timeout_us)
+{
+    uint64_t now = clk()->now_us();
+    uint64_t until = now + timeout_us;
+    uint64_t first = UINT64_MAX;
+    int n = 0;
+
+    // Earliest edge over all lines, simultaneous edges are returned together
+    for (auto &l : lines)
+    {
+        bool rising;
+        uint64_t t = l.second->next_edge(now, until, rising);
+        if (t == UINT64_MAX || t > first)
+            continue;
+        if (t < first)
+        {
+            first = t;
+            n = 0;
+        }
+        if (n < max)
+            ev[n++] = {l.first, rising, t};
+    }
+
+    clk()->sleep_until(n ? first : until);
+    return n;
+}
+
+sim_bus::sim_bus(/* args */)
+{
+}
+
+sim_bus::~sim_bus()
+{
+    for (auto dev : devices)
+        delete dev;
+}
+
+void sim_bus::add(sim_device *dev)
+{
+    devices.push_back(dev);
+}
+
+void sim_bus::add(sim_device *dev, sim_tca9548a *mux, uint8_t channel)
+{
+    dev->mux = mux;
+    dev->mux_channel = channel;
+    devices.push_back(dev);
+}
+
+bool sim_bus::visible(const sim_device *dev) const
+{
+    return dev->mux == nullptr || (visible(dev->mux) && (dev->mux->control & (1 << dev->mux_channel)));
+}
+
+int sim_bus::transfer(struct i2c_msg *msgs, uint32_t nmsgs)
+{
+    uint32_t bits = 2; // start and stop
+    int ret = nmsgs;
+
+    for (uint32_t i = 0; i < nmsgs; i++)
+    {
+        struct i2c_msg &m = msgs[i];
+        bits += (1 + m.len) * 9;
+
+        if (m.addr == 0x00 && not(m.flags & I2C_M_RD))
+        {
+            for (auto dev : devices)
+                if (visible(dev))
+                    dev->general_call(m.buf, m.len);
+            continue;
+        }
+
+        sim_device *target = nullptr;
+        for (auto dev : devices)
+        {
+            if (dev->address != m.addr || not visible(dev))
+                continue;
+            if (target)
+                collisions++;
+            target = dev;
+        }
+        if (target == nullptr)
+        {
+            errno = ENXIO;
+            ret = -1;
+            break;
+        }
+
+        int status = (m.flags & I2C_M_RD) ? target->read(m.buf, m.len) : target->write(m.buf, m.len);
+        if (status < 0)
+        {
+            errno = EREMOTEIO;
+            ret = -1;
+            break;
+        }
+    }
+
+    transactions++;
+    if (bitrate)
+    {
+        bit_time += bits * 1000000.0 / bitrate;
+        uint64_t us = (uint64_t)bit_time;
+        bit_time -= us;
+        bus_time_us += us;
+        if (vclock)
+            vclock->advance(us);
+    }
+    return ret;
+}
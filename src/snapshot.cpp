@@ -0,0 +1,258 @@
+/*
+ * File:     snapshot.cpp
+ * Notes:    Coherent multi-device snapshots by synchronized triggering
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "snapshot.hpp"
+#include "clock.hpp"
+#include <algorithm>
+#include <stdio.h>
+
+snapshot::snapshot(/* args */)
+{
+}
+
+snapshot::~snapshot()
+{
+}
+
+snapshot::member *snapshot::add(Type type, i_i2c *i2c)
+{
+    if (nmembers >= SNAPSHOT_MEMBERS)
+    {
+        printf("SNAPSHOT: ERROR - Too many members\n");
+        return nullptr;
+    }
+    member &m = members[nmembers++];
+    m.type = type;
+    m.i2c = i2c;
+    m.enabled = true;
+    m.status = 0;
+    m.deadline = 0;
+    return &m;
+}
+
+int snapshot::add(sht3x *dev)
+{
+    member *m = add(Type::SHT3X, dev->i2c);
+    if (m == nullptr)
+        return -1;
+    m->sht = dev;
+    return nmembers - 1;
+}
+
+int snapshot::add(ms5607 *dev)
+{
+    member *m = add(Type::MS5607, dev->i2c);
+    if (m == nullptr)
+        return -1;
+    m->ms = dev;
+    return nmembers - 1;
+}
+
+int snapshot::add(pac193x_base *dev)
+{
+    member *m = add(Type::PAC193X, dev->i2c);
+    if (m == nullptr)
+        return -1;
+    m->pac = dev;
+    return nmembers - 1;
+}
+
+void snapshot::enable(int n, bool on)
+{
+    if (n >= 0 && n < nmembers)
+        members[n].enabled = on;
+}
+
+int snapshot::status(int n) const
+{
+    if (n < 0 || n >= nmembers)
+        return -1;
+    return members[n].status;
+}
+
+int snapshot::trigger(uint64_t &before, uint64_t &after)
+{
+    struct i2c_msg msgs[SNAPSHOT_MEMBERS + 1];
+    uint8_t cmds[SNAPSHOT_MEMBERS][2];
+    uint8_t refresh_g = REFRESH_G;
+    bool pac_refresh = false;
+    i_i2c *via = bus;
+    uint32_t n = 0;
+
+    for (int i = 0; i < nmembers; i++)
+    {
+        member &m = members[i];
+        if (not m.enabled)
+            continue;
+        if (via == nullptr)
+            via = m.i2c;
+
+        struct i2c_msg &msg = msgs[n];
+        msg.addr = m.i2c->address;
+        msg.flags = 0;
+        msg.buf = cmds[i];
+        switch (m.type)
+        {
+        case Type::SHT3X:
+        {
+            uint16_t cmd = m.sht->single_cmd(rept);
+            cmds[i][0] = cmd >> 8;
+            cmds[i][1] = cmd & 0xFF;
+            msg.len = 2;
+            break;
+        }
+        case Type::MS5607:
+            cmds[i][0] = m.ms->d1_cmd();
+            msg.len = 1;
+            break;
+        case Type::PAC193X:
+            if (general_call)
+            {
+                pac_refresh = true;
+                continue; // one general call for all of them, below
+            }
+            cmds[i][0] = REFRESH;
+            msg.len = 1;
+            break;
+        }
+        n++;
+    }
+
+    // Last, the PACs latch at the end of the transaction like the others start
+    if (pac_refresh)
+    {
+        msgs[n].addr = 0x00;
+        msgs[n].flags = 0;
+        msgs[n].len = 1;
+        msgs[n].buf = &refresh_g;
+        n++;
+    }
+
+    if (n == 0)
+        return 0;
+
+    before = clk()->now_us();
+    int ret = via->Transfer(msgs, n);
+    after = clk()->now_us();
+    return ret;
+}
+
+int snapshot::collect(member &m, snapshot_frame &frame)
+{
+    uint16_t node = m.i2c->node();
+    uint64_t ts = frame.timestamp;
+
+    switch (m.type)
+    {
+    case Type::SHT3X:
+    {
+        uint8_t raw[RAW_DATA_SIZE];
+        if (frame.count + 2 > SNAPSHOT_SAMPLES || m.sht->read_single(raw) < 0)
+            return -1;
+        frame.samples[frame.count++] = {ts, make_channel(node, Kind::SHT3X_T), raw[0] << 8 | raw[1]};
+        frame.samples[frame.count++] = {ts, make_channel(node, Kind::SHT3X_RH), raw[3] << 8 | raw[4]};
+        return 0;
+    }
+
+    case Type::MS5607:
+    {
+        ms5607 *dev = m.ms;
+        if (frame.count + 2 > SNAPSHOT_SAMPLES || not dev->read_adc(dev->DP) || dev->DP == 0)
+            return -1;
+        // Compensation only, taken after the coherent D1
+        if (not dev->do_job(dev->d2_cmd(), dev->DT) || dev->DT == 0)
+            return -1;
+        frame.samples[frame.count++] = {ts, make_channel(node, Kind::MS5607_D1), (int32_t)dev->DP};
+        frame.samples[frame.count++] = {ts, make_channel(node, Kind::MS5607_D2), (int32_t)dev->DT};
+        return 0;
+    }
+
+    case Type::PAC193X:
+    {
+        // Instantaneous values, the averages span 8 earlier conversions.
+        // VBUS1..n then VSENSE1..n in one block, see pac193x_t
+        uint8_t buf[16];
+        uint8_t n = m.pac->channels;
+        if (frame.count + 2 * n > SNAPSHOT_SAMPLES)
+            return -1;
+        if (m.i2c->Read<uint8_t>(BUS1, buf, 4 * n) < 0)
+            return -1;
+        for (uint8_t ch = 0; ch < n; ch++)
+        {
+            frame.samples[frame.count++] = {ts, make_channel(node, Kind::PAC_VBUS, ch),
+                                            buf[2 * ch] << 8 | buf[2 * ch + 1]};
+            frame.samples[frame.count++] = {ts, make_channel(node, Kind::PAC_VSENSE, ch),
+                                            buf[2 * (n + ch)] << 8 | buf[2 * (n + ch) + 1]};
+        }
+        return 0;
+    }
+    }
+    return -1;
+}
+
+int snapshot::take(snapshot_frame &frame)
+{
+    member *order[SNAPSHOT_MEMBERS];
+    uint64_t before = 0, after = 0;
+    int n = 0;
+
+    frame.count = 0;
+    int ret = trigger(before, after);
+    if (ret < 0)
+    {
+        printf("SNAPSHOT: ERROR - Trigger\n");
+        for (int i = 0; i < nmembers; i++)
+            members[i].status = members[i].enabled ? -1 : 0;
+        return -1;
+    }
+
+    // Midpoint of the transaction, off by at most half the skew bound
+    uint64_t skew = after - before;
+    frame.timestamp = sample_time() - skew / 2;
+    frame.skew_us = skew;
+
+    for (int i = 0; i < nmembers; i++)
+    {
+        member &m = members[i];
+        m.status = 0;
+        if (not m.enabled)
+            continue;
+        switch (m.type)
+        {
+        case Type::SHT3X:
+            m.deadline = after + m.sht->duration_us(rept);
+            break;
+        case Type::MS5607:
+            m.deadline = after + m.ms->conv_us();
+            break;
+        case Type::PAC193X:
+            m.deadline = after + REFRESH_DELAY_US;
+            break;
+        }
+        order[n++] = &m;
+    }
+
+    // Collect in the order the results become ready
+    std::stable_sort(order, order + n,
+                     [](const member *a, const member *b) { return a->deadline < b->deadline; });
+    for (int i = 0; i < n; i++)
+    {
+        member &m = *order[i];
+        clk()->sleep_until(m.deadline);
+        m.status = collect(m, frame);
+        if (m.status < 0)
+            printf("SNAPSHOT: ERROR - Collect %s\n", m.i2c->alias);
+    }
+
+    frame.latency_us = clk()->now_us() - after;
+    taken++;
+    if (frame.skew_us > skew_max_us)
+        skew_max_us = frame.skew_us;
+    return frame.count;
+}
@@ -0,0 +1,438 @@
+/*
+ * File:     store.cpp
+ * Notes:    Append-only memory mapped columnar sample store
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "store.hpp"
+#include "i_i2c.hpp"
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <dirent.h>
+#include <algorithm>
+#include <set>
+
+static_assert(sizeof(segment_header) == 128, "segment header layout");
+
+#define VARINT_MAX 10 // bytes of a 64 bit varint
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static inline const uint8_t *get_varint(const uint8_t *p, uint64_t &v)
+{
+    uint64_t b = *p++;
+    v = b & 0x7F;
+    for (int shift = 7; b & 0x80; shift += 7)
+    {
+        b = *p++;
+        v |= (b & 0x7F) << shift;
+    }
+    return p;
+}
+
+std::string segment_name(uint32_t channel, uint32_t seq)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "ch-%08x-%06u.seg", channel, seq);
+    return name;
+}
+
+std::vector<uint32_t> segment_list(const std::string &dir, uint32_t channel)
+{
+    std::vector<uint32_t> seqs;
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL)
+        return seqs;
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL)
+    {
+        uint32_t ch, seq;
+        if (sscanf(e->d_name, "ch-%8x-%6u.seg", &ch, &seq) == 2 && ch == channel)
+            seqs.push_back(seq);
+    }
+    closedir(d);
+    std::sort(seqs.begin(), seqs.end());
+    return seqs;
+}
+
+sample_store::sample_store(/* args */)
+{
+}
+
+sample_store::~sample_store()
+{
+    close();
+}
+
+int sample_store::open_segment(segment &seg, uint32_t channel, uint32_t seq, bool create)
+{
+    std::string path = dir + "/" + segment_name(channel, seq);
+    struct stat st;
+
+    seg.fd = open(path.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0644);
+    if (seg.fd < 0)
+    {
+        printf("STORE: ERROR - Can't open %s: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    if (create)
+    {
+        seg.size = sizeof(segment_header) + 2 * (size_t)segment_size;
+        if (ftruncate(seg.fd, seg.size) < 0)
+        {
+            printf("STORE: ERROR - Can't size %s: %s\n", path.c_str(), strerror(errno));
+            ::close(seg.fd);
+            unlink(path.c_str());
+            seg.fd = -1;
+            return -1;
+        }
+    }
+    else if (fstat(seg.fd, &st) < 0)
+    {
+        printf("STORE: ERROR - Can't stat %s: %s\n", path.c_str(), strerror(errno));
+        ::close(seg.fd);
+        seg.fd = -1;
+        return -1;
+    }
+    else
+        seg.size = st.st_size;
+
+    void *map = mmap(NULL, seg.size, PROT_READ | PROT_WRITE, MAP_SHARED, seg.fd, 0);
+    if (map == MAP_FAILED || seg.size < sizeof(segment_header))
+    {
+        printf("STORE: ERROR - Can't map %s\n", path.c_str());
+        if (map != MAP_FAILED)
+            munmap(map, seg.size);
+        ::close(seg.fd);
+        seg.fd = -1;
+        return -1;
+    }
+
+    seg.seq = seq;
+    seg.base = (uint8_t *)map;
+    seg.hdr = (segment_header *)map;
+
+    if (create)
+    {
+        memset(seg.hdr, 0, sizeof(segment_header));
+        seg.hdr->magic = SEGMENT_MAGIC;
+        seg.hdr->version = SEGMENT_VERSION;
+        seg.hdr->channel = channel;
+        seg.hdr->column_size = segment_size;
+        seg.hdr->ts_offset = sizeof(segment_header);
+        seg.hdr->value_offset = sizeof(segment_header) + segment_size;
+    }
+    else if (seg.hdr->magic != SEGMENT_MAGIC || seg.hdr->channel != channel ||
+             seg.hdr->value_offset + seg.hdr->column_size > seg.size)
+    {
+        printf("STORE: ERROR - Bad segment %s\n", path.c_str());
+        munmap(map, seg.size);
+        ::close(seg.fd);
+        seg.fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void sample_store::repair(segment &seg)
+{
+    // A crash may leave column bytes past the last counted sample,
+    // rebuild the append state from the committed samples only
+    segment_header *h = seg.hdr;
+    const uint8_t *tp = seg.base + h->ts_offset;
+    const uint8_t *vp = seg.base + h->value_offset;
+    uint64_t t = h->first_ts;
+    int64_t delta = 0;
+    int64_t v = 0;
+
+    for (uint32_t i = 0; i < h->count; i++)
+    {
+        uint64_t raw;
+        tp = get_varint(tp, raw);
+        delta += unzigzag(raw);
+        t += delta;
+        vp = get_varint(vp, raw);
+        v += unzigzag(raw);
+    }
+    h->ts_bytes = tp - (seg.base + h->ts_offset);
+    h->value_bytes = vp - (seg.base + h->value_offset);
+    h->last_ts = t;
+    h->last_delta = delta;
+    h->last_value = (int32_t)v;
+}
+
+void sample_store::seal(segment &seg)
+{
+    segment_header *h = seg.hdr;
+    std::string path = dir + "/" + segment_name(h->channel, seg.seq);
+    // Hidden name, segment_list() doesn't take it for a segment
+    std::string tmp = dir + "/." + segment_name(h->channel, seg.seq);
+
+    // Readers may still scan the mapped file, it is never shrunk in place.
+    // The compacted copy replaces it by rename(), a reader keeps the old one.
+    segment_header sealed = *h;
+    sealed.sealed = 1;
+    sealed.value_offset = h->ts_offset + h->ts_bytes;
+    sealed.column_size = std::max(h->ts_bytes, h->value_bytes);
+
+    struct iovec iov[3] = {{&sealed, sizeof(sealed)},
+                           {seg.base + h->ts_offset, h->ts_bytes},
+                           {seg.base + h->value_offset, h->value_bytes}};
+    size_t used = sizeof(sealed) + h->ts_bytes + h->value_bytes;
+    bool copied = false;
+
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        copied = writev(fd, iov, 3) == (ssize_t)used && fsync(fd) == 0;
+        ::close(fd);
+        copied = copied && rename(tmp.c_str(), path.c_str()) == 0;
+        if (not copied)
+            unlink(tmp.c_str());
+    }
+    if (not copied)
+    {
+        // Keep the full size segment, sealed in place
+        printf("STORE: ERROR - Can't compact %s: %s\n", path.c_str(), strerror(errno));
+        h->sealed = 1;
+        msync(seg.base, seg.size, MS_SYNC);
+    }
+
+    munmap(seg.base, seg.size);
+    ::close(seg.fd);
+    seg.fd = -1;
+}
+
+void sample_store::expire(uint32_t channel, uint32_t newest)
+{
+    if (retention == 0)
+        return;
+
+    for (uint32_t seq : segment_list(dir, channel))
+    {
+        if (seq + retention > newest)
+            break;
+        std::string path = dir + "/" + segment_name(channel, seq);
+        printf("STORE: Expire %s\n", path.c_str());
+        unlink(path.c_str());
+    }
+}
+
+sample_store::segment *sample_store::get(uint32_t channel, uint64_t ts)
+{
+    auto it = open_segs.find(channel);
+    segment *seg = it == open_segs.end() ? nullptr : &it->second;
+
+    if (seg == nullptr)
+    {
+        // Continue the newest segment of a previous run when it has room
+        segment s = {-1, 0, 0, nullptr, nullptr};
+        std::vector<uint32_t> seqs = segment_list(dir, channel);
+        uint32_t seq = 0;
+        bool resumed = false;
+
+        if (not seqs.empty())
+        {
+            seq = seqs.back();
+            if (open_segment(s, channel, seq, false) == 0)
+            {
+                if (s.hdr->sealed)
+                {
+                    munmap(s.base, s.size);
+                    ::close(s.fd);
+                }
+                else
+                    resumed = true;
+            }
+            if (resumed)
+                repair(s);
+            else
+                seq++;
+        }
+        if (not resumed && open_segment(s, channel, seq, true) < 0)
+            return nullptr;
+        seg = &open_segs.emplace(channel, s).first->second;
+    }
+
+    segment_header *h = seg->hdr;
+    if (h->count && ts < h->last_ts)
+        return nullptr;
+
+    if (h->ts_bytes + VARINT_MAX > h->column_size || h->value_bytes + VARINT_MAX > h->column_size)
+    {
+        uint32_t seq = seg->seq + 1;
+        seal(*seg);
+        if (open_segment(*seg, channel, seq, true) < 0)
+        {
+            open_segs.erase(channel);
+            return nullptr;
+        }
+        expire(channel, seq);
+    }
+    return seg;
+}
+
+int sample_store::append(const sample &s)
+{
+    segment *seg = get(s.channel, s.timestamp);
+    if (seg == nullptr)
+        return -1;
+
+    segment_header *h = seg->hdr;
+    if (h->count == 0)
+    {
+        h->first_ts = s.timestamp;
+        h->last_ts = s.timestamp;
+        h->last_delta = 0;
+        h->last_value = 0;
+    }
+
+    int64_t delta = (int64_t)(s.timestamp - h->last_ts);
+    uint8_t *tp = seg->base + h->ts_offset + h->ts_bytes;
+    uint8_t *vp = seg->base + h->value_offset + h->value_bytes;
+
+    h->ts_bytes += put_varint(tp, zigzag(delta - h->last_delta)) - tp;
+    h->value_bytes += put_varint(vp, zigzag((int64_t)s.value - h->last_value)) - vp;
+    h->last_ts = s.timestamp;
+    h->last_delta = delta;
+    h->last_value = s.value;
+    // count last, a concurrent reader never sees a partial sample
+    __atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+size_t sample_store::append(const sample *s, size_t n)
+{
+    size_t done = 0;
+    for (size_t i = 0; i < n; i++)
+        if (append(s[i]) == 0)
+            done++;
+    return done;
+}
+
+int sample_store::flush()
+{
+    int ret = 0;
+    for (auto &it : open_segs)
+        if (msync(it.second.base, it.second.size, MS_ASYNC) < 0)
+            ret = -1;
+    return ret;
+}
+
+void sample_store::close()
+{
+    for (auto &it : open_segs)
+        seal(it.second);
+    open_segs.clear();
+}
+
+store_reader::store_reader(/* args */)
+{
+}
+
+store_reader::~store_reader()
+{
+}
+
+std::vector<uint32_t> store_reader::channels()
+{
+    std::set<uint32_t> found;
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL)
+        return {};
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL)
+    {
+        uint32_t ch, seq;
+        if (sscanf(e->d_name, "ch-%8x-%6u.seg", &ch, &seq) == 2)
+            found.insert(ch);
+    }
+    closedir(d);
+    return std::vector<uint32_t>(found.begin(), found.end());
+}
+
+size_t store_reader::scan(uint32_t channel, uint64_t from, uint64_t to,
+                          std::vector<uint64_t> &ts, std::vector<int32_t> &values)
+{
+    size_t found = 0;
+
+    for (uint32_t seq : segment_list(dir, channel))
+    {
+        std::string path = dir + "/" + segment_name(channel, seq);
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+
+        struct stat st;
+        void *map = fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(segment_header)
+                        ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+        ::close(fd);
+        if (map == MAP_FAILED)
+            continue;
+
+        const segment_header *h = (const segment_header *)map;
+        uint32_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+        if (h->magic != SEGMENT_MAGIC || count == 0 || h->first_ts > to || h->last_ts < from ||
+            (uint64_t)h->ts_offset + h->ts_bytes > (uint64_t)st.st_size ||
+            (uint64_t)h->value_offset + h->value_bytes > (uint64_t)st.st_size)
+        {
+            munmap(map, st.st_size);
+            continue;
+        }
+
+        const uint8_t *tp = (const uint8_t *)map + h->ts_offset;
+        const uint8_t *vp = (const uint8_t *)map + h->value_offset;
+        uint64_t t = h->first_ts;
+        int64_t delta = 0;
+        int64_t v = 0;
+
+        ts.reserve(ts.size() + count);
+        values.reserve(values.size() + count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint64_t raw;
+            tp = get_varint(tp, raw);
+            delta += unzigzag(raw);
+            t += delta;
+            vp = get_varint(vp, raw);
+            v += unzigzag(raw);
+
+            if (t > to)
+                break;
+            if (t >= from)
+            {
+                ts.push_back(t);
+                values.push_back((int32_t)v);
+                found++;
+            }
+        }
+        munmap(map, st.st_size);
+    }
+    return found;
+}
@@ -0,0 +1,483 @@
+/*
+ * File:     sysfs.cpp
+ * Notes:    Devices owned by kernel drivers, read through hwmon and IIO sysfs
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "sysfs.hpp"
+#include "record.hpp"
+#include "ms5607.hpp"
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+sysfs_attr::sysfs_attr(/* args */)
+{
+}
+
+sysfs_attr::~sysfs_attr()
+{
+    Close();
+}
+
+int sysfs_attr::Open(const char *dir, const char *attr)
+{
+    char path[SYSFS_PATH_MAX];
+
+    Close();
+    // A cut path would open another attribute
+    int len = snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    if (len < 0 || (size_t)len >= sizeof(path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    return fd < 0 ? -1 : 0;
+}
+
+void sysfs_attr::Close()
+{
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+}
+
+int sysfs_attr::read(char *buf, size_t size)
+{
+    ssize_t len = pread(fd, buf, size - 1, 0);
+    if (len <= 0)
+        return -1;
+    while (len > 0 && buf[len - 1] == '\n')
+        len--;
+    buf[len] = 0;
+    return 0;
+}
+
+int sysfs_attr::read(long long &value)
+{
+    char buf[32], *end;
+
+    if (read(buf, sizeof(buf)) < 0)
+        return -1;
+    value = strtoll(buf, &end, 10);
+    return end == buf ? -1 : 0;
+}
+
+int sysfs_attr::read(double &value)
+{
+    char buf[32], *end;
+
+    if (read(buf, sizeof(buf)) < 0)
+        return -1;
+    value = strtod(buf, &end);
+    return end == buf ? -1 : 0;
+}
+
+int sysfs_find(const char *dir, const char *name, char *path, size_t size)
+{
+    DIR *d = opendir(dir);
+    struct dirent *e;
+    char buf[64];
+    int ret = -1;
+
+    if (d == nullptr)
+        return -1;
+    while (ret < 0 && (e = readdir(d)) != nullptr)
+    {
+        if (e->d_name[0] == '.')
+            continue;
+        snprintf(path, size, "%s/%s", dir, e->d_name);
+
+        sysfs_attr attr;
+        if (attr.Open(path, "name") == 0 && attr.read(buf, sizeof(buf)) == 0 && strcmp(buf, name) == 0)
+            ret = 0;
+    }
+    closedir(d);
+    return ret;
+}
+
+int sysfs_write(const char *dir, const char *attr, const char *value)
+{
+    char path[SYSFS_PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    int fd = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t len = write(fd, value, strlen(value));
+    close(fd);
+    return len < 0 ? -1 : 0;
+}
+
+hwmon_sht3x::hwmon_sht3x(/* args */)
+{
+}
+
+hwmon_sht3x::~hwmon_sht3x()
+{
+}
+
+int hwmon_sht3x::Open()
+{
+    char dir[SYSFS_PATH_MAX], path[SYSFS_PATH_MAX];
+
+    snprintf(dir, sizeof(dir), "%s/class/hwmon", root);
+    if (sysfs_find(dir, name, path, sizeof(path)) < 0)
+    {
+        printf("HWMON: ERROR - No %s device in %s\n", name, dir);
+        return -1;
+    }
+    if (temp.Open(path, "temp1_input") < 0 || humidity.Open(path, "humidity1_input") < 0)
+    {
+        printf("HWMON: ERROR - Attributes of %s: %s\n", path, strerror(errno));
+        Close();
+        return -1;
+    }
+    printf("HWMON: %s at %s\n", name, path);
+    return 0;
+}
+
+void hwmon_sht3x::Close()
+{
+    temp.Close();
+    humidity.Close();
+}
+
+int hwmon_sht3x::get_results(float *temperature, float *hum)
+{
+    long long mt, mrh;
+
+    // Each read makes the driver fetch a new measurement if the old one is stale
+    if (temp.read(mt) < 0 || humidity.read(mrh) < 0)
+    {
+        printf("HWMON: ERROR - Read %s\n", name);
+        return -1;
+    }
+    *temperature = mt / 1000.0f;
+    *hum = mrh / 1000.0f;
+    return 0;
+}
+
+size_t hwmon_sht3x::read(sample *out, size_t max)
+{
+    float t, rh;
+
+    if (max < 2 || get_results(&t, &rh) < 0)
+        return 0;
+    uint64_t ts = sample_time();
+    out[0] = {ts, make_channel(node, Kind::SHT3X_T), record<Kind::SHT3X_T>::of(t).code};
+    out[1] = {ts, make_channel(node, Kind::SHT3X_RH), record<Kind::SHT3X_RH>::of(rh).code};
+    return 2;
+}
+
+iio_buffer::iio_buffer(/* args */)
+{
+}
+
+iio_buffer::~iio_buffer()
+{
+    Close();
+}
+
+int iio_buffer::parse(const char *name, element &e, int &index)
+{
+    char attr[64], buf[32], endian[3] = {};
+    char sign;
+    unsigned bits, storage, shift = 0;
+    sysfs_attr a;
+
+    // e.g. "le:s12/16>>4", a repeat count ("X2") is not supported
+    snprintf(attr, sizeof(attr), "scan_elements/in_%s_type", name);
+    if (a.Open(dir, attr) < 0 || a.read(buf, sizeof(buf)) < 0)
+        return -1;
+    if (sscanf(buf, "%2[lbe]:%c%u/%u>>%u", endian, &sign, &bits, &storage, &shift) < 4 ||
+        storage % 8 || storage > 64 || bits > storage)
+        return -1;
+    e.be = endian[0] == 'b';
+    e.is_signed = sign == 's';
+    e.bits = bits;
+    e.bytes = storage / 8;
+    e.shift = shift;
+
+    long long i;
+    snprintf(attr, sizeof(attr), "scan_elements/in_%s_index", name);
+    if (a.Open(dir, attr) < 0 || a.read(i) < 0)
+        return -1;
+    index = i;
+    return 0;
+}
+
+int iio_buffer::Open(const char *d, const char *devnode, const char *const *names, int n,
+                     uint32_t length, const char *trigger)
+{
+    int index[IIO_CHANNELS_MAX + 1], order[IIO_CHANNELS_MAX + 1];
+    char attr[64], value[16];
+
+    Close();
+    snprintf(dir, sizeof(dir), "%s", d);
+    if (n > IIO_CHANNELS_MAX || sysfs_write(dir, "buffer/enable", "0") < 0)
+        return -1;
+
+    for (int i = 0; i < n; i++)
+    {
+        snprintf(attr, sizeof(attr), "scan_elements/in_%s_en", names[i]);
+        if (parse(names[i], elements[i], index[i]) < 0 || sysfs_write(dir, attr, "1") < 0)
+            return -1;
+    }
+    nelements = n;
+    timestamp = parse("timestamp", elements[n], index[n]) == 0 &&
+                sysfs_write(dir, "scan_elements/in_timestamp_en", "1") == 0;
+    if (timestamp)
+        nelements++;
+
+    // Record layout: scan index order, each element aligned to its size
+    for (int i = 0; i < nelements; i++)
+    {
+        int j = i;
+        for (; j > 0 && index[order[j - 1]] > index[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    uint32_t offset = 0, align = 1;
+    for (int i = 0; i < nelements; i++)
+    {
+        element &e = elements[order[i]];
+        offset = (offset + e.bytes - 1) / e.bytes * e.bytes;
+        e.offset = offset;
+        offset += e.bytes;
+        align = e.bytes > align ? e.bytes : align;
+    }
+    record_size = (offset + align - 1) / align * align;
+    if (record_size * IIO_RECORDS > sizeof(records))
+        return -1;
+
+    snprintf(value, sizeof(value), "%u", length);
+    if (trigger[0] && sysfs_write(dir, "trigger/current_trigger", trigger) < 0)
+        printf("IIO: ERROR - Trigger %s\n", trigger);
+    if (sysfs_write(dir, "buffer/length", value) < 0 || sysfs_write(dir, "buffer/enable", "1") < 0)
+        return -1;
+
+    fd = open(devnode, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        printf("IIO: ERROR - Open %s: %s\n", devnode, strerror(errno));
+        sysfs_write(dir, "buffer/enable", "0");
+        return -1;
+    }
+    return 0;
+}
+
+void iio_buffer::Close()
+{
+    if (fd < 0)
+        return;
+    close(fd);
+    fd = -1;
+    sysfs_write(dir, "buffer/enable", "0");
+}
+
+int64_t iio_buffer::extract(const uint8_t *record, const element &e) const
+{
+    uint64_t v = 0;
+
+    for (uint8_t i = 0; i < e.bytes; i++)
+        v |= (uint64_t)record[e.offset + i] << (8 * (e.be ? e.bytes - 1 - i : i));
+    v >>= e.shift;
+    if (e.bits < 64)
+    {
+        v &= (1ULL << e.bits) - 1;
+        if (e.is_signed && (v >> (e.bits - 1)))
+            v |= ~0ULL << e.bits;
+    }
+    return (int64_t)v;
+}
+
+int iio_buffer::read(int64_t *values, int64_t *ts, int max)
+{
+    if (fd < 0)
+        return -1;
+    if (max > IIO_RECORDS)
+        max = IIO_RECORDS;
+
+    // Whole records only, the kernel never splits one
+    ssize_t len = ::read(fd, records, max * record_size);
+    if (len < 0)
+        return errno == EAGAIN ? 0 : -1;
+
+    int n = len / record_size;
+    int channels = nelements - timestamp;
+    for (int r = 0; r < n; r++)
+    {
+        const uint8_t *record = records + r * record_size;
+        for (int i = 0; i < channels; i++)
+            values[r * channels + i] = extract(record, elements[i]);
+        if (timestamp)
+            ts[r] = extract(record, elements[channels]);
+    }
+    return n;
+}
+
+iio_device::~iio_device()
+{
+    Close();
+}
+
+void iio_device::add(const char *attr, const char *scan, Kind kind, uint8_t index, bool raw, double to_code)
+{
+    if (nchannels >= IIO_CHANNELS_MAX)
+        return;
+    channel &c = channels[nchannels++];
+    snprintf(c.attr, sizeof(c.attr), "%s", attr);
+    snprintf(c.scan, sizeof(c.scan), "%s", scan);
+    c.kind = kind;
+    c.index = index;
+    c.raw = raw;
+    c.to_code = to_code;
+}
+
+int iio_device::Open()
+{
+    char dir[SYSFS_PATH_MAX], path[SYSFS_PATH_MAX], attr[64];
+    const char *names[IIO_CHANNELS_MAX];
+
+    snprintf(dir, sizeof(dir), "%s/bus/iio/devices", root);
+    if (sysfs_find(dir, name, path, sizeof(path)) < 0)
+    {
+        printf("IIO: ERROR - No %s device in %s\n", name, dir);
+        return -1;
+    }
+
+    for (int i = 0; i < nchannels; i++)
+    {
+        sysfs_attr a;
+        scale[i] = 1;
+        offset[i] = 0;
+        snprintf(attr, sizeof(attr), "in_%s_scale", channels[i].scan);
+        if (a.Open(path, attr) == 0)
+            a.read(scale[i]);
+        snprintf(attr, sizeof(attr), "in_%s_offset", channels[i].scan);
+        if (a.Open(path, attr) == 0)
+            a.read(offset[i]);
+
+        snprintf(attr, sizeof(attr), "in_%s", channels[i].attr);
+        if (attrs[i].Open(path, attr) < 0)
+        {
+            printf("IIO: ERROR - Open %s/%s: %s\n", path, attr, strerror(errno));
+            Close();
+            return -1;
+        }
+        names[i] = channels[i].scan;
+    }
+
+    // Character device has the name of the sysfs directory
+    char devnode[SYSFS_PATH_MAX];
+    snprintf(devnode, sizeof(devnode), "%s/%s", dev_root, strrchr(path, '/') + 1);
+    if (buffered && buffer.Open(path, devnode, names, nchannels, buffer_length, trigger) < 0)
+        buffer.Close();
+
+    printf("IIO: %s at %s%s\n", name, path, streaming() ? ", buffered" : "");
+    return 0;
+}
+
+void iio_device::Close()
+{
+    buffer.Close();
+    for (int i = 0; i < nchannels; i++)
+        attrs[i].Close();
+}
+
+int32_t iio_device::code(int i, double value) const
+{
+    return (int32_t)lrint(value * channels[i].to_code);
+}
+
+size_t iio_device::read(sample *out, size_t max)
+{
+    size_t k = 0;
+
+    if (streaming())
+    {
+        int64_t values[IIO_RECORDS * IIO_CHANNELS_MAX], ts[IIO_RECORDS];
+        int records = (int)(max / nchannels);
+        int n = buffer.read(values, ts, records < IIO_RECORDS ? records : IIO_RECORDS);
+        for (int r = 0; r < n; r++)
+        {
+            // Kernel timestamps follow current_timestamp_clock, realtime by default
+            uint64_t t = buffer.timestamp ? ts[r] / 1000 : sample_time();
+            for (int i = 0; i < nchannels; i++)
+            {
+                int64_t v = values[r * nchannels + i];
+                last[i] = channels[i].raw ? code(i, v) : code(i, (v + offset[i]) * scale[i]);
+                out[k++] = {t, make_channel(node, channels[i].kind, channels[i].index), last[i]};
+            }
+        }
+        return k;
+    }
+
+    uint64_t t = sample_time();
+    for (int i = 0; i < nchannels && k < max; i++)
+    {
+        double v;
+        if (attrs[i].read(v) < 0)
+        {
+            printf("IIO: ERROR - Read %s in_%s\n", name, channels[i].attr);
+            continue;
+        }
+        last[i] = code(i, v);
+        out[k++] = {t, make_channel(node, channels[i].kind, channels[i].index), last[i]};
+    }
+    return k;
+}
+
+iio_ms5607::iio_ms5607(/* args */)
+{
+    name = "ms5607";
+    node = 0x76;
+    add("temp_input", "temp", Kind::BARO_T, 0, false, 0.1);        // [m°C] to [0.01 °C]
+    add("pressure_input", "pressure", Kind::BARO_P, 0, false, 1000); // [kPa] to [0.01 mbar]
+}
+
+float iio_ms5607::get_altitude() const
+{
+    return ms5607::altitude(get_pressure(), get_temperature());
+}
+
+iio_pac193x::iio_pac193x(uint8_t channels, bool mean) : nch(channels)
+{
+    char attr[32], scan[12]; // Up to "current256_mean_raw", "current256"
+
+    name = "pac1934";
+    node = 0x10;
+    // The driver numbers channels from 1
+    for (uint8_t ch = 0; ch < nch; ch++)
+    {
+        snprintf(scan, sizeof(scan), "voltage%u", ch + 1);
+        snprintf(attr, sizeof(attr), "%s_%sraw", scan, mean ? "mean_" : "");
+        add(attr, scan, Kind::PAC_VBUS, ch, true, 1);
+    }
+    for (uint8_t ch = 0; ch < nch; ch++)
+    {
+        snprintf(scan, sizeof(scan), "current%u", ch + 1);
+        snprintf(attr, sizeof(attr), "%s_%sraw", scan, mean ? "mean_" : "");
+        add(attr, scan, Kind::PAC_VSENSE, ch, true, 1);
+    }
+}
+
+float iio_pac193x::get_bus_voltage(uint8_t ch) const
+{
+    return (last[ch] + offset[ch]) * scale[ch] / 1000.0; // scale is [mV]
+}
+
+float iio_pac193x::get_current(uint8_t ch) const
+{
+    return (last[nch + ch] + offset[nch + ch]) * scale[nch + ch]; // scale is [mA]
+}
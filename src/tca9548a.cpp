@@ -0,0 +1,132 @@
+/*
+ * File:     tca9548a.cpp
+ * Notes:    TCA9548A style I2C multiplexer and mux aware job scheduling
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "tca9548a.hpp"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Mux that was selected last per bus, its channel may still be on
+static std::mutex active_lock;
+static std::map<std::string, tca9548a *> active;
+
+tca9548a::tca9548a(/* args */)
+{
+}
+
+tca9548a::~tca9548a()
+{
+    std::lock_guard<std::mutex> guard(active_lock);
+    for (auto it = active.begin(); it != active.end(); ++it)
+    {
+        if (it->second == this)
+        {
+            active.erase(it);
+            break;
+        }
+    }
+}
+
+int tca9548a::release_others()
+{
+    tca9548a *other;
+    {
+        std::lock_guard<std::mutex> guard(active_lock);
+        tca9548a *&last = active[i2c->device];
+        other = last;
+        last = this;
+    }
+    if (other == nullptr || other == this)
+        return 0;
+
+    if (other->deselect() < 0)
+    {
+        // Its channel may still be on, retried on the next select
+        std::lock_guard<std::mutex> guard(active_lock);
+        active[i2c->device] = other;
+        return -1;
+    }
+    return 0;
+}
+
+int tca9548a::write_control(uint8_t value)
+{
+    struct i2c_msg msg;
+
+    msg.addr = i2c->address;
+    msg.flags = 0;
+    msg.len = 1;
+    msg.buf = &value;
+    selects++;
+    if (i2c->Transfer(&msg, 1) < 0)
+    {
+        printf("%s: ERROR - Select 0x%02x\n", i2c->alias, value);
+        invalidate();
+        return -1;
+    }
+    control = value;
+    return 0;
+}
+
+int tca9548a::select(uint8_t channel)
+{
+    if (channel >= MUX_CHANNELS)
+        return -1;
+
+    if (current == channel)
+    {
+        skipped++;
+        return 0;
+    }
+
+    if (release_others() < 0 || write_control(1 << channel) < 0)
+        return -1;
+    current = channel;
+    return 0;
+}
+
+int tca9548a::deselect()
+{
+    if (write_control(0) < 0)
+        return -1;
+    current = MUX_UNKNOWN;
+    return 0;
+}
+
+void mux_scheduler::add(i_i2c *dev, std::function<void()> work)
+{
+    jobs.push_back({dev, work});
+}
+
+size_t mux_scheduler::run()
+{
+    // Rank: direct devices first (no switch), then channels already
+    // selected, then the rest by mux and channel
+    auto rank = [](const job &j) -> uint32_t
+    {
+        if (j.dev->mux == nullptr)
+            return 0;
+        uint32_t key = (uint32_t)j.dev->mux->i2c->address << 8 | j.dev->mux_channel;
+        return (j.dev->mux->selected() == j.dev->mux_channel ? 1u << 16 : 2u << 16) | key;
+    };
+
+    order.resize(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return rank(jobs[a]) < rank(jobs[b]); });
+
+    for (size_t i : order)
+        jobs[i].work();
+
+    size_t n = jobs.size();
+    jobs.clear();
+    return n;
+}
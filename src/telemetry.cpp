@@ -0,0 +1,322 @@
+/*
+ * File:     telemetry.cpp
+ * Notes:    Binary sample stream over a Unix domain socket, publisher and client
+ *
+ * Author:   Engr. Max Parker
+ * Created:  Mon Oct 19 2026
+ *
+ */
+
+#include "telemetry.hpp"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+static int make_address(const std::string &path, struct sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        return -1;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return 0;
+}
+
+telemetry_publisher::telemetry_publisher(/* args */)
+{
+}
+
+telemetry_publisher::~telemetry_publisher()
+{
+    Close();
+}
+
+int telemetry_publisher::Open()
+{
+    struct sockaddr_un addr;
+
+    if (queue == 0 || (queue & (queue - 1)) != 0 || frame == 0 || make_address(path, addr) < 0)
+        return -1;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        printf("TLM: Can't create socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // A stale socket of a previous run would make bind() fail
+    unlink(path.c_str());
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, TELEMETRY_SUBSCRIBERS) < 0)
+    {
+        printf("TLM: Can't listen on %s: %s\n", path.c_str(), strerror(errno));
+        close(fd);
+        fd = -1;
+        return -1;
+    }
+    printf("TLM: Publish on %s, %u samples per frame\n", path.c_str(), frame);
+    return 0;
+}
+
+void telemetry_publisher::Close()
+{
+    if (fd < 0)
+        return;
+
+    while (not subs.empty())
+        drop(subs.size() - 1);
+    close(fd);
+    unlink(path.c_str());
+    fd = -1;
+}
+
+void telemetry_publisher::accept_all()
+{
+    for (;;)
+    {
+        int sfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (sfd < 0)
+            return;
+        if (subs.size() >= TELEMETRY_SUBSCRIBERS)
+        {
+            printf("TLM: Subscriber refused, %d connected\n", TELEMETRY_SUBSCRIBERS);
+            close(sfd);
+            continue;
+        }
+
+        subscriber sub = {};
+        sub.fd = sfd;
+        sub.ring.resize(queue);
+        subs.push_back(std::move(sub));
+        printf("TLM: Subscriber %zu connected\n", subs.size() - 1);
+    }
+}
+
+bool telemetry_publisher::receive(subscriber &sub)
+{
+    telemetry_subscribe msg;
+    const size_t fixed = offsetof(telemetry_subscribe, filters);
+
+    for (;;)
+    {
+        ssize_t len = recv(sub.fd, &msg, sizeof(msg), MSG_DONTWAIT);
+        if (len == 0)
+            return false; // closed by the subscriber
+        if (len < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+        if ((size_t)len < fixed || msg.magic != TELEMETRY_SUB_MAGIC || msg.count > TELEMETRY_FILTERS ||
+            (size_t)len < fixed + msg.count * sizeof(telemetry_filter))
+        {
+            printf("TLM: Invalid subscribe message, %zd bytes\n", len);
+            continue;
+        }
+        memcpy(sub.filters, msg.filters, msg.count * sizeof(telemetry_filter));
+        sub.nfilters = msg.count;
+        sub.subscribed = true;
+    }
+}
+
+bool telemetry_publisher::selected(const subscriber &sub, uint32_t channel) const
+{
+    if (sub.nfilters == 0)
+        return true;
+    for (uint32_t i = 0; i < sub.nfilters; i++)
+        if ((channel & sub.filters[i].mask) == sub.filters[i].value)
+            return true;
+    return false;
+}
+
+void telemetry_publisher::publish(const sample *s, size_t n)
+{
+    if (fd < 0)
+        return;
+
+    accept_all();
+    for (size_t i = subs.size(); i-- > 0;)
+    {
+        subscriber &sub = subs[i];
+        if (not receive(sub))
+        {
+            drop(i);
+            continue;
+        }
+        if (not sub.subscribed)
+            continue;
+
+        const uint64_t mask = queue - 1;
+        for (size_t k = 0; k < n; k++)
+        {
+            if (not selected(sub, s[k].channel))
+                continue;
+            // Drop oldest, the newest samples are the ones worth having
+            if (sub.head - sub.tail == queue)
+            {
+                sub.tail++;
+                sub.dropped++;
+                dropped++;
+            }
+            sub.ring[sub.head++ & mask] = s[k];
+        }
+    }
+}
+
+int telemetry_publisher::send(subscriber &sub)
+{
+    telemetry_header hdr[TELEMETRY_MMSG];
+    struct iovec iov[TELEMETRY_MMSG][3];
+    struct mmsghdr msgs[TELEMETRY_MMSG];
+    uint16_t counts[TELEMETRY_MMSG];
+    const uint64_t mask = queue - 1;
+    int total = 0;
+
+    while (sub.head != sub.tail)
+    {
+        // Frames straight from the queue, a wrapped frame takes two iovecs
+        uint64_t pos = sub.tail;
+        int m = 0;
+        memset(msgs, 0, sizeof(msgs));
+        while (m < TELEMETRY_MMSG && pos != sub.head)
+        {
+            uint64_t left = sub.head - pos;
+            uint16_t count = left < frame ? left : frame;
+            uint32_t start = pos & mask;
+            uint32_t first = queue - start < count ? queue - start : count;
+
+            hdr[m] = {TELEMETRY_MAGIC, TELEMETRY_VERSION, count, sub.seq + m, sub.dropped};
+            iov[m][0] = {&hdr[m], sizeof(hdr[m])};
+            iov[m][1] = {&sub.ring[start], first * sizeof(sample)};
+            iov[m][2] = {&sub.ring[0], (count - first) * sizeof(sample)};
+            msgs[m].msg_hdr.msg_iov = iov[m];
+            msgs[m].msg_hdr.msg_iovlen = first < count ? 3 : 2;
+            counts[m] = count;
+            pos += count;
+            m++;
+        }
+
+        int k = sendmmsg(sub.fd, msgs, m, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (k < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                break; // socket full, the queue absorbs it
+            return -1;
+        }
+        for (int i = 0; i < k; i++)
+        {
+            sub.tail += counts[i];
+            total += counts[i];
+        }
+        sub.seq += k;
+        frames += k;
+        if (k < m)
+            break;
+    }
+    return total;
+}
+
+size_t telemetry_publisher::flush()
+{
+    size_t total = 0;
+
+    for (size_t i = subs.size(); i-- > 0;)
+    {
+        int n = send(subs[i]);
+        if (n < 0)
+        {
+            drop(i);
+            continue;
+        }
+        total += n;
+    }
+    sent += total;
+    return total;
+}
+
+void telemetry_publisher::drop(size_t i)
+{
+    printf("TLM: Subscriber %zu gone, %u frames, %u samples dropped\n", i, subs[i].seq, subs[i].dropped);
+    close(subs[i].fd);
+    subs.erase(subs.begin() + i);
+}
+
+telemetry_client::telemetry_client(/* args */)
+{
+}
+
+telemetry_client::~telemetry_client()
+{
+    Close();
+}
+
+int telemetry_client::Open(const telemetry_filter *filters, uint32_t n)
+{
+    struct sockaddr_un addr;
+
+    if (make_address(path, addr) < 0)
+        return -1;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        printf("TLM: Can't connect to %s: %s\n", path.c_str(), strerror(errno));
+        Close();
+        return -1;
+    }
+    next_seq = 0;
+    lost = 0;
+    return subscribe(filters, n);
+}
+
+void telemetry_client::Close()
+{
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+}
+
+int telemetry_client::subscribe(const telemetry_filter *filters, uint32_t n)
+{
+    telemetry_subscribe msg;
+
+    if (n > TELEMETRY_FILTERS)
+        return -1;
+    msg.magic = TELEMETRY_SUB_MAGIC;
+    msg.count = n;
+    if (n)
+        memcpy(msg.filters, filters, n * sizeof(telemetry_filter));
+
+    size_t len = offsetof(telemetry_subscribe, filters) + n * sizeof(telemetry_filter);
+    return ::send(fd, &msg, len, MSG_NOSIGNAL) == (ssize_t)len ? 0 : -1;
+}
+
+int telemetry_client::read(sample *out, size_t max)
+{
+    telemetry_header hdr;
+    struct iovec iov[2] = {{&hdr, sizeof(hdr)}, {out, max * sizeof(sample)}};
+    struct msghdr msg = {};
+
+    // Samples land in out directly, no intermediate buffer
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t len = recvmsg(fd, &msg, 0);
+    if (len <= 0)
+        return -1;
+    if ((size_t)len < sizeof(hdr) || hdr.magic != TELEMETRY_MAGIC || hdr.version != TELEMETRY_VERSION)
+        return -1;
+    if (msg.msg_flags & MSG_TRUNC)
+    {
+        printf("TLM: Frame of %u samples truncated to %zu\n", hdr.count, max);
+        return -1;
+    }
+
+    lost += hdr.seq - next_seq;
+    next_seq = hdr.seq + 1;
+    dropped = hdr.dropped;
+    return (len - sizeof(hdr)) / sizeof(sample);
+}